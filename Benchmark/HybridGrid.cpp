@@ -0,0 +1,39 @@
+#include "../QuadTree/HybridQuadTree.hpp"
+#include "IndexBenchmark.hpp"
+#include <random>
+
+// Usage: HybridGrid; compares a plain QuadTree with HybridQuadTree at several grid resolutions on the raster
+// main.cpp loads, to see how many top levels the grid should replace
+int main() {
+    constexpr int MAP_SIZE = 3600;
+    constexpr int NUM_QUERIES = 1000000;
+    const Rect boundary(MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f);
+
+    std::vector<Point> points;
+    points.reserve(static_cast<size_t>(MAP_SIZE) * MAP_SIZE);
+    for (int x = 0; x < MAP_SIZE; ++x) {
+        for (int y = 0; y < MAP_SIZE; ++y) {
+            points.emplace_back(static_cast<float>(x), static_cast<float>(y), static_cast<float>(x + y) / 2.0f);
+        }
+    }
+
+    auto gen = std::mt19937(42);
+    std::uniform_int_distribution dis(0, MAP_SIZE - 1);
+    std::vector<Point> targets;
+    targets.reserve(NUM_QUERIES);
+    for (int i = 0; i < NUM_QUERIES; ++i) {
+        targets.emplace_back(static_cast<float>(dis(gen)), static_cast<float>(dis(gen)));
+    }
+
+    std::cout << points.size() << " points\n";
+    {
+        QuadTree tree(boundary);
+        runIndexBenchmark("QuadTree", tree, points, targets);
+    }
+    for (const int levels : { 2, 4, 6, 8 }) {
+        HybridQuadTree hybrid(boundary, levels);
+        const std::string label = "HybridQuadTree " + std::to_string(hybrid.cellsPerSide()) + "x" + std::to_string(hybrid.cellsPerSide());
+        runIndexBenchmark(label.c_str(), hybrid, points, targets);
+    }
+    return 0;
+}
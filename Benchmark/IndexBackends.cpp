@@ -0,0 +1,67 @@
+#include "../QuadTree/UniformGridIndex.hpp"
+#include "IndexBenchmark.hpp"
+#include <random>
+
+// Usage: IndexBackends; compares QuadTree and UniformGridIndex on datasets of increasing skew, so a backend can
+// be picked per dataset
+int main() {
+    constexpr int MAP_SIZE = 1000;
+    constexpr int NUM_POINTS = MAP_SIZE * MAP_SIZE;
+    constexpr int NUM_QUERIES = 200000;
+    const Rect boundary(MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f);
+
+    auto gen = std::mt19937(42);
+    auto clamp = [&](const float v) { return std::clamp(v, 0.0f, static_cast<float>(MAP_SIZE)); };
+
+    std::vector<std::pair<const char *, std::vector<Point>>> datasets;
+    {
+        std::vector<Point> points; // The integer raster main.cpp loads, at a smaller size
+        for (int x = 0; x < MAP_SIZE; ++x) {
+            for (int y = 0; y < MAP_SIZE; ++y) points.emplace_back(static_cast<float>(x), static_cast<float>(y));
+        }
+        datasets.emplace_back("integer grid", std::move(points));
+    }
+    {
+        std::vector<Point> points;
+        std::uniform_real_distribution dis(0.0f, static_cast<float>(MAP_SIZE));
+        for (int i = 0; i < NUM_POINTS; ++i) points.emplace_back(dis(gen), dis(gen));
+        datasets.emplace_back("uniform random", std::move(points));
+    }
+    {
+        std::vector<Point> points; // 50 Gaussian clusters of different spreads
+        std::uniform_real_distribution centre(0.0f, static_cast<float>(MAP_SIZE));
+        std::uniform_real_distribution spread(2.0f, 40.0f);
+        for (int c = 0; c < 50; ++c) {
+            std::normal_distribution dx(centre(gen), spread(gen)), dy(centre(gen), spread(gen));
+            for (int i = 0; i < NUM_POINTS / 50; ++i) points.emplace_back(clamp(dx(gen)), clamp(dy(gen)));
+        }
+        datasets.emplace_back("gaussian clusters", std::move(points));
+    }
+    {
+        std::vector<Point> points; // Density falling off exponentially from one corner
+        std::exponential_distribution dis(1.0f / 30.0f);
+        for (int i = 0; i < NUM_POINTS; ++i) points.emplace_back(clamp(dis(gen)), clamp(dis(gen)));
+        datasets.emplace_back("exponential skew", std::move(points));
+    }
+
+    for (const auto &[name, points] : datasets) {
+        // Queries are drawn from the data itself, so every backend is asked where the points are
+        std::vector<Point> targets;
+        std::uniform_int_distribution<size_t> pick(0, points.size() - 1);
+        for (int i = 0; i < NUM_QUERIES; ++i) targets.push_back(points[pick(gen)]);
+
+        std::cout << name << " (" << points.size() << " points)\n";
+        {
+            QuadTree tree(boundary);
+            runIndexBenchmark("QuadTree", tree, points, targets);
+        }
+        for (const float pointsPerCell : { 1.0f, 4.0f }) {
+            int columns = 0, rows = 0;
+            UniformGridIndex::resolutionFor(boundary, points.size(), pointsPerCell, columns, rows);
+            UniformGridIndex grid(boundary, columns, rows);
+            const std::string label = "UniformGridIndex " + std::to_string(columns) + "x" + std::to_string(rows);
+            runIndexBenchmark(label.c_str(), grid, points, targets);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef INDEXBENCHMARK_H
+#define INDEXBENCHMARK_H
+
+#include "../QuadTree/SpatialIndex.hpp"
+#include <iostream>
+#include <chrono>
+
+// Times insertion, then KNN and 16x16 range queries at the targets, of one backend through the SpatialIndex API
+template<SpatialIndex Index>
+void runIndexBenchmark(const char *backend, Index &index, const std::vector<Point> &points, const std::vector<Point> &targets) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const Point &p : points) index.insert(p);
+    auto end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> insert_time = end - start;
+
+    std::array<Point, 8> nearest;
+    double checksum = 0.0;
+    start = std::chrono::high_resolution_clock::now();
+    for (const Point &target : targets) {
+        const size_t found = index.template nearestNeighbors<8>(target, nearest);
+        if (found > 0) checksum += static_cast<double>(distanceSquared(target, nearest[found - 1]));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> knn_time = end - start;
+
+    long long hits = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < targets.size(); i += 10) {
+        index.queryRange(Rect(targets[i].x, targets[i].y, 8.0f, 8.0f), [&](const Point &) { ++hits; });
+    }
+    end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> range_time = end - start;
+
+    std::cout << "  " << backend << ": insert " << insert_time.count() << " s, KNN " << knn_time.count() / static_cast<double>(targets.size()) * 1e6
+              << " us/query, range " << range_time.count() / static_cast<double>(targets.size() / 10) * 1e6 << " us/query"
+              << " (checksum " << checksum << ", hits " << hits << ")\n";
+}
+
+#endif //INDEXBENCHMARK_H
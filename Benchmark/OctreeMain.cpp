@@ -0,0 +1,66 @@
+#include "../QuadTree/Orthtree.hpp"
+#include "PerfCounter.hpp"
+#include <iostream>
+#include <chrono>
+#include <random>
+
+// 3D counterpart of main.cpp: fills a lattice volume, then times KNN queries at random lattice sites
+int main() {
+    constexpr int MAP_SIZE = 200;
+    constexpr int NUM_QUERIES = 1000000;
+
+    const float half = MAP_SIZE / 2.0f;
+    Octree ot(Box3({ half, half, half }, { half, half, half }));
+
+    // Measure insertion time
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int x = 0; x < MAP_SIZE; ++x) {
+        for (int y = 0; y < MAP_SIZE; ++y) {
+            for (int z = 0; z < MAP_SIZE; ++z) {
+                ot.insert(Point3({ static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) }, static_cast<float>(z)));
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> insert_time = end - start;
+    std::cout << "Insertion time: " << insert_time.count() << " seconds (" << ot.size() << " points)\n";
+
+    // Setup random number generation for queries
+    std::random_device rd;
+    std::seed_seq sd{rd(), rd(), rd(), rd()};
+    auto gen = std::mt19937(sd);
+    std::uniform_int_distribution dis(0, MAP_SIZE - 1);
+
+    std::vector<Point3> targets;
+    targets.reserve(NUM_QUERIES);
+    for (int i = 0; i < NUM_QUERIES; ++i) {
+        targets.emplace_back(std::array<float, 3>{ static_cast<float>(dis(gen)), static_cast<float>(dis(gen)), static_cast<float>(dis(gen)) });
+    }
+
+    // Preallocate nearest neighbors array and heap
+    std::array<Point3, 8> nearest;
+    float maxDist = std::numeric_limits<float>::max();
+    std::vector<std::pair<float, Point3>> nearestHeap;
+    nearestHeap.reserve(8);
+    Octree::NodeQueue nodeQueue;
+    const PerfCounter llcMisses = PerfCounter::llcMisses();
+
+    // Measure nearest neighbor search time
+    double checksum = 0.0;
+    llcMisses.start();
+    start = std::chrono::high_resolution_clock::now();
+    for (const Point3 &target : targets) {
+        nearestHeap.clear();
+        while (!nodeQueue.empty()) nodeQueue.pop();
+        ot.nearestNeighbors<8>(target, nearest, maxDist, nodeQueue, nearestHeap);
+        checksum += static_cast<double>(maxDist);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> nn_search_time = end - start;
+
+    std::cout << "Total nearest neighbor search time: " << nn_search_time.count() << " seconds\n";
+    std::cout << "Average time per search: " << (nn_search_time.count() / NUM_QUERIES) << " seconds\n";
+    llcMisses.report(std::cout, "LLC misses");
+    std::cout << "Result checksum: " << checksum << "\n";
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Counts one hardware cache event for the calling thread through perf_event_open.
+// When the kernel refuses the counter (no PMU, perf_event_paranoid too strict) valid() is false
+// and the benchmark prints n/a instead of a number.
+class PerfCounter {
+    int fd = -1;
+
+    PerfCounter(const uint32_t type, const uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static uint64_t cacheMisses(const uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+public:
+    static PerfCounter llcMisses() { return PerfCounter(PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_LL)); }
+    static PerfCounter dtlbMisses() { return PerfCounter(PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_DTLB)); }
+
+    PerfCounter(PerfCounter &&other) noexcept : fd(other.fd) { other.fd = -1; }
+    PerfCounter(const PerfCounter &) = delete;
+    PerfCounter &operator=(const PerfCounter &) = delete;
+    ~PerfCounter() {
+        if (fd >= 0) close(fd);
+    }
+
+    [[nodiscard]] bool valid() const { return fd >= 0; }
+
+    void start() const {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    // Stops counting and returns the count since start(), 0 when the counter is unavailable
+    uint64_t stop() const {
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t value = 0;
+        if (read(fd, &value, sizeof(value)) != sizeof(value)) return 0;
+        return value;
+    }
+
+    // Prints the count since start(), or n/a when the counter is unavailable
+    void report(std::ostream &out, const char *name) const {
+        out << name << ": ";
+        if (valid()) out << stop();
+        else out << "n/a";
+        out << '\n';
+    }
+};
+
+#endif //PERFCOUNTER_H
@@ -0,0 +1,46 @@
+#include "../QuadTree/ShardedQuadTree.hpp"
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <thread>
+
+// Usage: ShardedIngestBenchmark [threads]; times the same multi-writer ingest at growing shard counts
+int main(const int argc, char **argv) {
+    constexpr int MAP_SIZE = 3600;
+    constexpr int POINTS_PER_THREAD = 1000000;
+    const int threads = argc > 1 ? std::max(1, std::atoi(argv[1])) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    const Rect world(MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f);
+
+    // Every writer gets its own pre-drawn stream of points spread over the whole world
+    std::vector<std::vector<Point>> streams(static_cast<size_t>(threads));
+    for (int t = 0; t < threads; ++t) {
+        auto gen = std::mt19937(static_cast<unsigned>(t + 1));
+        std::uniform_real_distribution dis(0.0f, static_cast<float>(MAP_SIZE));
+        streams[static_cast<size_t>(t)].reserve(POINTS_PER_THREAD);
+        for (int i = 0; i < POINTS_PER_THREAD; ++i) {
+            streams[static_cast<size_t>(t)].emplace_back(dis(gen), dis(gen));
+        }
+    }
+
+    std::cout << "Writers: " << threads << "\n";
+    for (const int side : { 1, 2, 4, 8, 16 }) {
+        ShardedQuadTree tree(world, side, side);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&tree, &stream = streams[static_cast<size_t>(t)]] {
+                for (const Point &p : stream) tree.insert(p);
+            });
+        }
+        for (std::thread &worker : workers) worker.join();
+        const auto end = std::chrono::high_resolution_clock::now();
+
+        const std::chrono::duration<double> ingest_time = end - start;
+        const double total = static_cast<double>(threads) * POINTS_PER_THREAD;
+        std::cout << "Shards: " << tree.shardCount() << ", ingest time: " << ingest_time.count()
+                  << " seconds, throughput: " << total / ingest_time.count() << " points/s\n";
+    }
+    return 0;
+}
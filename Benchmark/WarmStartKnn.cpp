@@ -0,0 +1,81 @@
+#include "../QuadTree/QuadTree.hpp"
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+// Usage: WarmStartKnn; follows agents moving a few units per frame and times their KNN queries cold and
+// seeded with the previous frame's neighbours, at several speeds
+int main() {
+    constexpr int MAP_SIZE = 3600;
+    constexpr int NUM_POINTS = 4000000;
+    constexpr int NUM_AGENTS = 10000;
+    constexpr int NUM_FRAMES = 100;
+    const Rect boundary(MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f);
+
+    auto gen = std::mt19937(42);
+    std::uniform_real_distribution position(0.0f, static_cast<float>(MAP_SIZE));
+    std::vector<Point> points;
+    points.reserve(NUM_POINTS);
+    for (int i = 0; i < NUM_POINTS; ++i) points.emplace_back(position(gen), position(gen));
+    QuadTree tree(boundary);
+    tree.insertBatch(points);
+
+    std::uniform_real_distribution heading(0.0f, 6.2831853f);
+    for (const float speed : { 0.1f, 1.0f, 5.0f }) {
+        // Every agent walks a straight line at the same speed, turning back at the edges of the map
+        std::vector<Point> agents, velocities;
+        for (int a = 0; a < NUM_AGENTS; ++a) {
+            agents.emplace_back(position(gen), position(gen));
+            const float angle = heading(gen);
+            velocities.emplace_back(speed * std::cos(angle), speed * std::sin(angle));
+        }
+        std::vector<std::array<Point, 8>> previous(NUM_AGENTS);
+        for (int a = 0; a < NUM_AGENTS; ++a) tree.nearestNeighbors<8>(agents[a], previous[a]);
+
+        double coldTime = 0.0, seededTime = 0.0, coldChecksum = 0.0, seededChecksum = 0.0;
+        std::array<Point, 8> nearest;
+        for (int frame = 0; frame < NUM_FRAMES; ++frame) {
+            for (int a = 0; a < NUM_AGENTS; ++a) {
+                Point &agent = agents[a];
+                Point &velocity = velocities[a];
+                if (agent.x + velocity.x < 0.0f || agent.x + velocity.x > MAP_SIZE) velocity.x = -velocity.x;
+                if (agent.y + velocity.y < 0.0f || agent.y + velocity.y > MAP_SIZE) velocity.y = -velocity.y;
+                agent = Point(agent.x + velocity.x, agent.y + velocity.y);
+            }
+
+            auto cold = [&] {
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (int a = 0; a < NUM_AGENTS; ++a) {
+                    tree.nearestNeighbors<8>(agents[a], nearest);
+                    coldChecksum += static_cast<double>(distanceSquared(agents[a], nearest[7]));
+                }
+                const auto end = std::chrono::high_resolution_clock::now();
+                coldTime += std::chrono::duration<double>(end - start).count();
+            };
+            auto seeded = [&] {
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (int a = 0; a < NUM_AGENTS; ++a) {
+                    tree.nearestNeighborsSeeded<8>(agents[a], previous[a], nearest);
+                    seededChecksum += static_cast<double>(distanceSquared(agents[a], nearest[7]));
+                    previous[a] = nearest;
+                }
+                const auto end = std::chrono::high_resolution_clock::now();
+                seededTime += std::chrono::duration<double>(end - start).count();
+            };
+            // Alternate which pass runs first, so neither always finds the other's nodes in cache
+            if (frame % 2 == 0) {
+                cold();
+                seeded();
+            } else {
+                seeded();
+                cold();
+            }
+        }
+
+        constexpr double queries = static_cast<double>(NUM_AGENTS) * NUM_FRAMES;
+        std::cout << "Speed " << speed << " per frame: cold " << coldTime * 1e6 / queries << " us/query, seeded "
+                  << seededTime * 1e6 / queries << " us/query (checksums " << coldChecksum << ", " << seededChecksum << ")\n";
+    }
+    return 0;
+}
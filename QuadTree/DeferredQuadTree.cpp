@@ -0,0 +1,55 @@
+#include "DeferredQuadTree.hpp"
+
+DeferredQuadTree::DeferredQuadTree(const Rect &boundary, const bool growable, const size_t scanLimit)
+    : quadTree(boundary, growable), growable(growable), scanLimit(scanLimit) {}
+
+const Rect &DeferredQuadTree::getBoundary() const {
+    return quadTree.getBoundary();
+}
+
+size_t DeferredQuadTree::staged() const {
+    return stagedX.size();
+}
+
+bool DeferredQuadTree::insert(const Point &point) {
+    // A growable root reaches any point once committed; a fixed one rejects it now rather than at commit
+    if (!growable && !quadTree.getBoundary().contains(point)) return false;
+    stagedX.push_back(point.x);
+    stagedY.push_back(point.y);
+    stagedPayload.push_back(point.payload);
+    return true;
+}
+
+void DeferredQuadTree::insertBatch(const std::span<const Point> batch) {
+    stagedX.reserve(stagedX.size() + batch.size());
+    stagedY.reserve(stagedY.size() + batch.size());
+    stagedPayload.reserve(stagedPayload.size() + batch.size());
+    for (const Point &point : batch) insert(point);
+}
+
+size_t DeferredQuadTree::commit() {
+    return build();
+}
+
+// Const so that queries can build too; the tree and the lanes are mutable for this
+size_t DeferredQuadTree::build() const {
+    if (stagedX.empty()) return 0;
+
+    std::vector<Point> batch;
+    batch.reserve(stagedX.size());
+    for (size_t i = 0; i < stagedX.size(); ++i) batch.emplace_back(stagedX[i], stagedY[i], stagedPayload[i]);
+    // Release the lanes rather than clearing them, a load phase is not expected to follow right away
+    stagedX = {};
+    stagedY = {};
+    stagedPayload = {};
+    return quadTree.insertBatch(batch);
+}
+
+void DeferredQuadTree::commitIfLarge() const {
+    if (stagedX.size() > scanLimit) build();
+}
+
+const QuadTree &DeferredQuadTree::tree() const {
+    build();
+    return quadTree;
+}
@@ -0,0 +1,57 @@
+#ifndef DEFERREDQUADTREE_H
+#define DEFERREDQUADTREE_H
+
+#include "QuadTree.hpp"
+
+#include <vector>
+
+// A QuadTree for workloads that alternate between load phases without queries and query phases without
+// writes. insert only appends to a staging buffer; commit() hands the whole buffer to QuadTree::insertBatch,
+// which bulk-builds an empty tree and batch-merges into a filled one. Queries see staged points too: up to
+// scanLimit of them are scanned brute force beside the tree, and a query finding more staged commits first,
+// so the first query of a query phase pays for the build. Such a query modifies the index, which must then
+// not be queried from several threads at once; commit() before sharing it.
+class DeferredQuadTree {
+    mutable QuadTree quadTree;
+    bool growable;
+    size_t scanLimit;
+
+    // Staged points, one coordinate per lane so the scans below vectorize
+    mutable std::vector<float> stagedX, stagedY, stagedPayload;
+
+    size_t build() const; // Insert the staged points into the tree and release the buffer
+    void commitIfLarge() const; // Build unless the staged points are few enough to scan
+
+public:
+    static constexpr size_t DEFAULT_SCAN_LIMIT = 4096; // A few tens of microseconds to scan
+
+    // Constructor for an empty QuadTree(boundary, growable) that queries commit into once more than scanLimit
+    // points are staged; 0 commits on every query that finds staged points
+    explicit DeferredQuadTree(const Rect &boundary, bool growable = false, size_t scanLimit = DEFAULT_SCAN_LIMIT);
+
+    [[nodiscard]] const Rect &getBoundary() const; // The tree's root boundary
+    [[nodiscard]] size_t staged() const; // Number of points waiting for commit()
+
+    // Stage a point for the next commit; false, staging nothing, if it is outside a fixed root
+    bool insert(const Point &point);
+    void insertBatch(std::span<const Point> batch); // Stage every point of batch the tree accepts
+
+    // Insert the staged points into the tree in one batch and empty the buffer. Returns the number inserted,
+    // which is short of the number staged only when a growable root could not reach a point.
+    size_t commit();
+
+    [[nodiscard]] const QuadTree &tree() const; // The tree after committing, for the full QuadTree query set
+
+    // Visit every point inside range (edges included), staged ones after those in the tree
+    template<typename Visitor>
+    void queryRange(const Rect &range, Visitor &&visitor) const;
+
+    // The N nearest points to target, nearest first, over the tree and the staged points, skipping target
+    // itself once like QuadTree::nearestNeighbors. Returns the number of points found.
+    template<size_t N>
+    size_t nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const;
+};
+
+#include "DeferredQuadTree.tpp"
+
+#endif //DEFERREDQUADTREE_H
@@ -0,0 +1,69 @@
+#ifndef DEFERREDQUADTREE_TPP
+#define DEFERREDQUADTREE_TPP
+
+#include <algorithm>
+#include <limits>
+
+template<typename Visitor>
+void DeferredQuadTree::queryRange(const Rect &range, Visitor &&visitor) const {
+    commitIfLarge();
+    quadTree.queryRange(range, visitor);
+    if (stagedX.empty()) return;
+
+    // Branch-free containment over the lanes, then visit the few points that passed
+    thread_local std::vector<unsigned char> inside;
+    const size_t count = stagedX.size();
+    inside.resize(count);
+    const float left = range.x - range.w, right = range.x + range.w;
+    const float top = range.y - range.h, bottom = range.y + range.h;
+    const float *xs = stagedX.data(), *ys = stagedY.data();
+    unsigned char *flags = inside.data();
+    for (size_t i = 0; i < count; ++i) {
+        flags[i] = (xs[i] >= left) & (xs[i] <= right) & (ys[i] >= top) & (ys[i] <= bottom);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (flags[i]) visitor(Point(xs[i], ys[i], stagedPayload[i]));
+    }
+}
+
+template<size_t N>
+size_t DeferredQuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const {
+    commitIfLarge();
+    thread_local std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    thread_local std::vector<std::pair<float, Point>> nearestHeap;
+    thread_local std::vector<float> distances;
+    nearestHeap.clear();
+    float maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false;
+    quadTree.gatherNearest<N>(target, maxDist, targetSkipped, nodeQueue, nearestHeap);
+
+    if (!stagedX.empty()) {
+        // Distances to every staged point in one vectorized pass, then only those that beat the heap are offered
+        const size_t count = stagedX.size();
+        distances.resize(count);
+        const float *xs = stagedX.data(), *ys = stagedY.data();
+        float *dist = distances.data();
+        for (size_t i = 0; i < count; ++i) {
+            const float dx = xs[i] - target.x;
+            const float dy = ys[i] - target.y;
+            dist[i] = dx * dx + dy * dy;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (nearestHeap.size() == N && dist[i] >= maxDist) continue;
+            const Point candidate(xs[i], ys[i], stagedPayload[i]);
+            if (!targetSkipped && candidate == target) {
+                targetSkipped = true;
+                continue;
+            }
+            offerNearest<N>(nearestHeap, dist[i], candidate, maxDist);
+        }
+    }
+
+    std::sort(nearestHeap.begin(), nearestHeap.end()); // A heap only once N candidates were found
+    for (size_t i = 0; i < nearestHeap.size(); ++i) {
+        nearest[i] = nearestHeap[i].second;
+    }
+    return nearestHeap.size();
+}
+
+#endif // DEFERREDQUADTREE_TPP
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "DeferredQuadTree.hpp"
+#include "SpatialIndex.hpp"
+#include "TestHelpers.hpp"
+
+static_assert(SpatialIndex<DeferredQuadTree>);
+
+class DeferredQuadTreeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create a tree covering a 100x100 area centered at (0,0) that scans up to 64 staged points
+        tree = std::make_unique<DeferredQuadTree>(Rect(0.0f, 0.0f, 50.0f, 50.0f), false, 64);
+    }
+
+    // A lattice reaching the boundary with a few duplicates, offset so two lattices do not coincide
+    static std::vector<Point> lattice(const float offset) {
+        std::vector<Point> points;
+        for (int i = -48; i <= 48; i += 8) {
+            for (int j = -48; j <= 48; j += 6) {
+                points.emplace_back(static_cast<float>(i) + offset, static_cast<float>(j) + offset, static_cast<float>(i * j));
+            }
+        }
+        for (int k = 0; k < 3; ++k) points.emplace_back(10.0f + offset, 10.0f + offset);
+        return points;
+    }
+
+    std::unique_ptr<DeferredQuadTree> tree;
+};
+
+// Test that inserts only stage points until commit builds the tree
+TEST_F(DeferredQuadTreeTest, CommitBuildsTree) {
+    const std::vector<Point> points = lattice(0.0f);
+    for (const Point &p : points) EXPECT_TRUE(tree->insert(p));
+    EXPECT_FALSE(tree->insert(Point(50.5f, 0.0f))); // Outside the fixed root
+    EXPECT_EQ(tree->staged(), points.size());
+
+    EXPECT_EQ(tree->commit(), points.size());
+    EXPECT_EQ(tree->staged(), 0u);
+    EXPECT_EQ(tree->commit(), 0u);
+
+    int count = 0;
+    tree->tree().queryRange(tree->getBoundary(), [&](const Point &) { ++count; });
+    EXPECT_EQ(count, static_cast<int>(points.size()));
+    EXPECT_EQ(tree->tree().aggregate(tree->getBoundary()).count, static_cast<long long>(points.size()));
+}
+
+// Test that queries see a few staged points beside the committed ones without building
+TEST_F(DeferredQuadTreeTest, QueriesScanStagedPoints) {
+    std::vector<Point> all = lattice(0.0f);
+    tree->insertBatch(all);
+    tree->commit();
+
+    const std::vector<Point> late = { Point(1.0f, 1.0f, 7.0f), Point(-49.5f, 49.5f), Point(10.0f, 10.0f), Point(20.0f, -3.0f) };
+    tree->insertBatch(late);
+    all.insert(all.end(), late.begin(), late.end());
+    EXPECT_EQ(tree->staged(), late.size());
+
+    for (const Rect &range : { Rect(0.0f, 0.0f, 50.0f, 50.0f), Rect(1.0f, 1.0f, 0.0f, 0.0f), Rect(15.0f, 5.0f, 5.0f, 8.0f) }) {
+        std::vector<Point> found, expected;
+        tree->queryRange(range, [&](const Point &p) { found.push_back(p); });
+        for (const Point &p : all) {
+            if (range.contains(p)) expected.push_back(p);
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(found, expected);
+    }
+
+    std::array<Point, 6> nearest;
+    for (const Point &target : { Point(1.0f, 1.0f), Point(10.0f, 10.0f), Point(-50.0f, 50.0f), Point(30.0f, -20.0f) }) {
+        const std::vector<float> expected = bruteForce<6>(all, target);
+        ASSERT_EQ(tree->nearestNeighbors<6>(target, nearest), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) EXPECT_EQ(distanceSquared(target, nearest[i]), expected[i]);
+    }
+    EXPECT_EQ(tree->staged(), late.size()); // Still staged, the queries only scanned them
+}
+
+// Test that a query finding more staged points than the scan limit builds the tree first
+TEST_F(DeferredQuadTreeTest, QueryBuildsAboveScanLimit) {
+    const std::vector<Point> points = lattice(0.5f);
+    ASSERT_GT(points.size(), 64u);
+    tree->insertBatch(points);
+    EXPECT_EQ(tree->staged(), points.size());
+
+    std::array<Point, 4> nearest;
+    const Point target(10.5f, 10.5f);
+    const std::vector<float> expected = bruteForce<4>(points, target);
+    ASSERT_EQ(tree->nearestNeighbors<4>(target, nearest), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) EXPECT_EQ(distanceSquared(target, nearest[i]), expected[i]);
+    EXPECT_EQ(tree->staged(), 0u);
+    EXPECT_TRUE(tree->tree().isDivided());
+}
+
+// Test staging points outside a growable root, which commit grows toward
+TEST_F(DeferredQuadTreeTest, GrowableRoot) {
+    DeferredQuadTree growing(Rect(0.0f, 0.0f, 1.0f, 1.0f), true);
+    EXPECT_TRUE(growing.insert(Point(0.5f, 0.5f)));
+    EXPECT_TRUE(growing.insert(Point(90.0f, -40.0f)));
+
+    std::array<Point, 2> nearest;
+    EXPECT_EQ(growing.nearestNeighbors<2>(Point(80.0f, -40.0f), nearest), 2u); // Scanned while staged
+    EXPECT_EQ(nearest[0], Point(90.0f, -40.0f));
+
+    EXPECT_EQ(growing.commit(), 2u);
+    EXPECT_TRUE(growing.getBoundary().contains(Point(90.0f, -40.0f)));
+    EXPECT_EQ(growing.nearestNeighbors<2>(Point(80.0f, -40.0f), nearest), 2u);
+    EXPECT_EQ(nearest[1], Point(0.5f, 0.5f));
+}
+
+// Test asking an empty tree
+TEST_F(DeferredQuadTreeTest, Empty) {
+    std::array<Point, 3> nearest;
+    EXPECT_EQ(tree->nearestNeighbors<3>(Point(0.0f, 0.0f), nearest), 0u);
+    int count = 0;
+    tree->queryRange(tree->getBoundary(), [&](const Point &) { ++count; });
+    EXPECT_EQ(count, 0);
+}
@@ -0,0 +1,154 @@
+#include "DurableQuadTree.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <unistd.h>
+#include <utility>
+
+// Snapshot layout: magic, sequence of the last update it holds, root boundary, point count, then the points
+// as x/y/payload floats, all in host byte order
+static constexpr char SNAPSHOT_MAGIC[8] = {'Q', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+
+DurableQuadTree::DurableQuadTree(const Rect &boundary, const bool growable, std::string snapshotPath, std::string logPath,
+                                 const Journal::Options &options)
+    : quadTree(boundary, growable), growable(growable), snapshotPath(std::move(snapshotPath)), logPath(std::move(logPath)), options(options) {}
+
+const QuadTree &DurableQuadTree::tree() const {
+    return quadTree;
+}
+
+bool DurableQuadTree::recover(size_t &replayed) {
+    replayed = 0;
+    uint64_t sequence = 0;
+    if (!loadSnapshot(sequence)) return false;
+
+    std::vector<JournalRecord> records;
+    if (!journal.open(logPath, options, sequence + 1, records)) return false;
+    return replay(records, sequence, replayed);
+}
+
+bool DurableQuadTree::loadSnapshot(uint64_t &sequence) {
+    std::FILE *in = std::fopen(snapshotPath.c_str(), "rb");
+    if (!in) return errno == ENOENT; // No snapshot yet, start from the constructor's tree
+
+    char magic[8];
+    float boundary[4];
+    uint64_t count = 0;
+    bool ok = std::fread(magic, 1, 8, in) == 8 && std::memcmp(magic, SNAPSHOT_MAGIC, 8) == 0 &&
+              std::fread(&sequence, 8, 1, in) == 1 && std::fread(boundary, 4, 4, in) == 4 && std::fread(&count, 8, 1, in) == 1;
+
+    std::vector<float> coords;
+    if (ok) {
+        coords.resize(count * 3);
+        ok = std::fread(coords.data(), 4, coords.size(), in) == coords.size();
+    }
+    std::fclose(in);
+    if (!ok) return false;
+
+    std::vector<Point> points;
+    points.reserve(count);
+    for (size_t i = 0; i < coords.size(); i += 3) points.emplace_back(coords[i], coords[i + 1], coords[i + 2]);
+    quadTree = QuadTree(Rect(boundary[0], boundary[1], boundary[2], boundary[3]), growable);
+    return quadTree.insertBatch(points) == points.size();
+}
+
+// Consecutive inserts are gathered and applied as one batch; a remove or move flushes the batch first,
+// so updates still take effect in log order
+bool DurableQuadTree::replay(const std::vector<JournalRecord> &records, const uint64_t after, size_t &replayed) {
+    std::vector<Point> batch;
+    bool ok = true;
+    auto flush = [&] {
+        ok &= quadTree.insertBatch(batch) == batch.size();
+        batch.clear();
+    };
+
+    for (const JournalRecord &record : records) {
+        if (record.sequence <= after) continue; // Already in the snapshot, the log was not emptied in time
+        ++replayed;
+        switch (record.op) {
+            case JournalRecord::Op::Insert:
+                batch.push_back(record.to);
+                break;
+            case JournalRecord::Op::Remove:
+                flush();
+                ok &= quadTree.removeExact(record.to);
+                break;
+            case JournalRecord::Op::Move:
+                flush();
+                ok &= quadTree.moveExact(record.from, record.to);
+                break;
+        }
+    }
+    flush();
+    return ok;
+}
+
+bool DurableQuadTree::stores(const Point &point) const {
+    bool found = false;
+    quadTree.queryRange(Rect(point.x, point.y, 0.0f, 0.0f), [&](const Point &p) { found |= p.payload == point.payload; });
+    return found;
+}
+
+// Each update is validated first, so once its record is appended applying it cannot fail, in the tree or in replay
+bool DurableQuadTree::insert(const Point &point) {
+    if (!journal.isOpen() || !quadTree.accepts(point)) return false;
+    return journal.append(JournalRecord::Op::Insert, Point(), point) && quadTree.insert(point);
+}
+
+bool DurableQuadTree::remove(const Point &point) {
+    if (!journal.isOpen() || !stores(point)) return false;
+    return journal.append(JournalRecord::Op::Remove, Point(), point) && quadTree.removeExact(point);
+}
+
+bool DurableQuadTree::move(const Point &from, const Point &to) {
+    if (!journal.isOpen() || !stores(from) || !quadTree.accepts(to)) return false;
+    return journal.append(JournalRecord::Op::Move, from, to) && quadTree.moveExact(from, to);
+}
+
+bool DurableQuadTree::commit() {
+    return journal.sync();
+}
+
+bool DurableQuadTree::failed() const {
+    return journal.hasFailed();
+}
+
+// Written to a temporary file and renamed over the old snapshot, so a crash leaves one complete snapshot.
+// The log is only emptied once the rename is durable; if that never happens, recovery skips the records
+// the snapshot already holds by their sequence.
+bool DurableQuadTree::snapshot() {
+    if (!journal.sync()) return false;
+
+    std::vector<float> coords;
+    coords.reserve(static_cast<size_t>(quadTree.aggregate(quadTree.getBoundary()).count) * 3);
+    quadTree.queryRange(quadTree.getBoundary(), [&](const Point &p) {
+        coords.push_back(p.x);
+        coords.push_back(p.y);
+        coords.push_back(p.payload);
+    });
+
+    const std::string temporary = snapshotPath + ".tmp";
+    std::FILE *out = std::fopen(temporary.c_str(), "wb");
+    if (!out) return false;
+    const uint64_t sequence = journal.lastSequence();
+    const Rect &root = quadTree.getBoundary();
+    const float boundary[4] = {root.x, root.y, root.w, root.h};
+    const uint64_t count = coords.size() / 3;
+    bool ok = std::fwrite(SNAPSHOT_MAGIC, 1, 8, out) == 8 && std::fwrite(&sequence, 8, 1, out) == 1 &&
+              std::fwrite(boundary, 4, 4, out) == 4 && std::fwrite(&count, 8, 1, out) == 1 &&
+              std::fwrite(coords.data(), 4, coords.size(), out) == coords.size();
+    ok = std::fflush(out) == 0 && ok && ::fsync(fileno(out)) == 0;
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), snapshotPath.c_str()) != 0) return false;
+
+    // Make the rename itself durable before the log it replaces is emptied
+    const std::filesystem::path directory = std::filesystem::path(snapshotPath).parent_path();
+    const int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0) return false;
+    ok = ::fsync(dir) == 0;
+    ::close(dir);
+    return ok && journal.reset();
+}
@@ -0,0 +1,56 @@
+#ifndef DURABLEQUADTREE_H
+#define DURABLEQUADTREE_H
+
+#include "Journal.hpp"
+#include "QuadTree.hpp"
+
+#include <string>
+
+// A QuadTree whose inserts, removes and moves are recorded in a Journal, with snapshots to bound recovery.
+// recover() loads the latest snapshot and replays only the log records written after it, feeding runs of
+// inserts through QuadTree::insertBatch, so recovery time follows the size of the log tail rather than the
+// history of the tree. An update is durable once the group holding it has been fsynced (see Journal::Options)
+// or commit() has returned. Timestamps are not logged; recovered points never expire.
+class DurableQuadTree {
+    QuadTree quadTree;
+    bool growable;
+    std::string snapshotPath; // Replaced atomically by snapshot()
+    std::string logPath; // Emptied by snapshot() once the snapshot is durable
+    Journal::Options options;
+    Journal journal;
+
+    bool loadSnapshot(uint64_t &sequence); // Replace quadTree with the snapshot, if there is one
+    bool replay(const std::vector<JournalRecord> &records, uint64_t after, size_t &replayed); // Apply records after a sequence
+    [[nodiscard]] bool stores(const Point &point) const; // True if a point with point's coordinates and payload is stored
+
+public:
+    // Constructor for a tree that starts out as QuadTree(boundary, growable) when no snapshot exists yet
+    DurableQuadTree(const Rect &boundary, bool growable, std::string snapshotPath, std::string logPath, const Journal::Options &options = {});
+
+    // Load the latest snapshot, replay the log tail after it and open the log for appending. Must be called
+    // before the first update. replayed reports how many log records were applied. False on an I/O error or
+    // a corrupt snapshot.
+    bool recover(size_t &replayed);
+
+    // The QuadTree operations, write-ahead: an update is checked against the tree, appended to the log and
+    // only then applied, so the tree never holds an update the log lacks. remove and move match the payload
+    // as well as the coordinates, both logged, so replay removes the same point when several share a position.
+    // False, leaving the tree unchanged, if the tree would reject the update, the log could not be written or
+    // recover() has not opened it yet.
+    // A failed log write or fsync poisons the journal, and every later update, commit and snapshot fails.
+    // The tree then holds the updates accepted before the failure, while the log may lack those not yet
+    // fsynced and may hold the one that failed; recover a new DurableQuadTree to continue from the log.
+    bool insert(const Point &point);
+    bool remove(const Point &point);
+    bool move(const Point &from, const Point &to);
+
+    bool commit(); // Write and fsync every logged update
+    [[nodiscard]] bool failed() const; // A log write or fsync failed, see above
+
+    // Write every point to a new snapshot, replace the old one atomically, then empty the log
+    bool snapshot();
+
+    [[nodiscard]] const QuadTree &tree() const; // Read access for queries
+};
+
+#endif //DURABLEQUADTREE_H
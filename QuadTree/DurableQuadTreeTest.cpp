@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+#include "DurableQuadTree.hpp"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+class DurableQuadTreeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Fresh snapshot and log files per test
+        const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        snapshotPath = ::testing::TempDir() + "DurableQuadTreeTest_" + name + ".snapshot";
+        logPath = ::testing::TempDir() + "DurableQuadTreeTest_" + name + ".log";
+        std::remove(snapshotPath.c_str());
+        std::remove(logPath.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(snapshotPath.c_str());
+        std::remove(logPath.c_str());
+    }
+
+    // Open a tree covering a 100x100 area centered at (0,0) and recover it from the files
+    std::unique_ptr<DurableQuadTree> open(size_t &replayed, const Journal::Options &options = {}) {
+        auto tree = std::make_unique<DurableQuadTree>(Rect(0.0f, 0.0f, 50.0f, 50.0f), false, snapshotPath, logPath, options);
+        EXPECT_TRUE(tree->recover(replayed));
+        return tree;
+    }
+
+    // All points of a tree, sorted
+    static std::vector<Point> contents(const QuadTree &tree) {
+        std::vector<Point> points;
+        tree.queryRange(tree.getBoundary(), [&](const Point &p) { points.push_back(p); });
+        std::sort(points.begin(), points.end());
+        return points;
+    }
+
+    static Point pointAt(const int i) {
+        return Point(static_cast<float>((i * 37) % 99) - 49.0f, static_cast<float>((i * 53) % 97) - 48.0f, static_cast<float>(i));
+    }
+
+    // Swap every descriptor this process holds on path for a read-only one, so writes through it fail
+    static void makeUnwritable(const std::string &path) {
+        const std::filesystem::path target = std::filesystem::canonical(path);
+        const int readOnly = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        ASSERT_GE(readOnly, 0);
+        int swapped = 0;
+        for (const auto &entry : std::filesystem::directory_iterator("/proc/self/fd")) {
+            std::error_code error;
+            if (std::filesystem::read_symlink(entry.path(), error) != target || error) continue;
+            ASSERT_GE(::dup2(readOnly, std::stoi(entry.path().filename().string())), 0);
+            ++swapped;
+        }
+        ::close(readOnly);
+        EXPECT_EQ(swapped, 1);
+    }
+
+    std::string snapshotPath;
+    std::string logPath;
+};
+
+// Test inserts, removes and moves survive reopening through the log alone
+TEST_F(DurableQuadTreeTest, RecoverFromLog) {
+    size_t replayed = 0;
+    std::vector<Point> expected;
+    {
+        auto tree = open(replayed);
+        EXPECT_EQ(replayed, 0u);
+        for (int i = 0; i < 500; ++i) EXPECT_TRUE(tree->insert(pointAt(i)));
+        for (int i = 0; i < 100; ++i) EXPECT_TRUE(tree->remove(pointAt(i)));
+        EXPECT_TRUE(tree->move(pointAt(200), Point(0.5f, 0.5f, 200.0f)));
+        EXPECT_FALSE(tree->insert(Point(70.0f, 0.0f)));  // Rejected updates are not logged
+        EXPECT_TRUE(tree->commit());
+        expected = contents(tree->tree());
+    }
+    auto recovered = open(replayed);
+    EXPECT_EQ(replayed, 601u);
+    EXPECT_EQ(contents(recovered->tree()), expected);
+}
+
+// Test removes and moves pick the point with the logged payload among points sharing its coordinates
+TEST_F(DurableQuadTreeTest, SharedCoordinatesMatchPayload) {
+    size_t replayed = 0;
+    auto payloads = [](const QuadTree &tree, const Point &at) {
+        std::vector<float> found;
+        tree.queryRange(Rect(at.x, at.y, 0.0f, 0.0f), [&](const Point &p) { found.push_back(p.payload); });
+        std::sort(found.begin(), found.end());
+        return found;
+    };
+    {
+        auto tree = open(replayed);
+        for (int i = 0; i < 200; ++i) EXPECT_TRUE(tree->insert(pointAt(i)));
+        for (int i = 0; i < 6; ++i) EXPECT_TRUE(tree->insert(Point(1.0f, 1.0f, static_cast<float>(i))));
+        EXPECT_TRUE(tree->remove(Point(1.0f, 1.0f, 4.0f)));
+        EXPECT_TRUE(tree->move(Point(1.0f, 1.0f, 2.0f), Point(2.0f, 2.0f, 2.0f)));
+        EXPECT_FALSE(tree->remove(Point(1.0f, 1.0f, 4.0f)));  // Already gone, though others share its coordinates
+        EXPECT_FALSE(tree->move(Point(1.0f, 1.0f, 9.0f), Point(3.0f, 3.0f, 9.0f)));
+        EXPECT_EQ(payloads(tree->tree(), Point(1.0f, 1.0f)), (std::vector<float>{ 0.0f, 1.0f, 3.0f, 5.0f }));
+        EXPECT_TRUE(tree->commit());
+    }
+    auto recovered = open(replayed);
+    EXPECT_EQ(replayed, 208u);
+    EXPECT_EQ(payloads(recovered->tree(), Point(1.0f, 1.0f)), (std::vector<float>{ 0.0f, 1.0f, 3.0f, 5.0f }));
+    EXPECT_EQ(payloads(recovered->tree(), Point(2.0f, 2.0f)), (std::vector<float>{ 2.0f }));
+}
+
+// Test updates before recover() neither change the tree nor reach the log
+TEST_F(DurableQuadTreeTest, UpdatesBeforeRecover) {
+    {
+        DurableQuadTree tree(Rect(0.0f, 0.0f, 50.0f, 50.0f), false, snapshotPath, logPath);
+        EXPECT_FALSE(tree.insert(pointAt(1)));
+        EXPECT_EQ(tree.tree().aggregate(tree.tree().getBoundary()).count, 0);
+    }
+    size_t replayed = 0;
+    auto recovered = open(replayed);
+    EXPECT_EQ(replayed, 0u);
+    EXPECT_TRUE(contents(recovered->tree()).empty());
+}
+
+// Test an update the tree would reject is neither logged nor applied, growable roots included
+TEST_F(DurableQuadTreeTest, RejectedUpdatesNotLogged) {
+    size_t replayed = 0;
+    auto tree = open(replayed);
+    EXPECT_TRUE(tree->insert(pointAt(1)));
+    EXPECT_FALSE(tree->insert(Point(70.0f, 0.0f)));
+    EXPECT_FALSE(tree->move(pointAt(1), Point(0.0f, -80.0f)));
+    EXPECT_FALSE(tree->remove(pointAt(2)));
+    EXPECT_TRUE(tree->commit());
+
+    std::vector<JournalRecord> records;
+    EXPECT_TRUE(Journal::read(logPath, records));
+    EXPECT_EQ(records.size(), 1u);
+    EXPECT_EQ(contents(tree->tree()), std::vector<Point>{ pointAt(1) });
+
+    DurableQuadTree growing(Rect(0.1f, 0.3f, 0.7f, 0.9f), true, snapshotPath + ".growing", logPath + ".growing");
+    ASSERT_TRUE(growing.recover(replayed));
+    EXPECT_TRUE(growing.insert(Point(300.0f, -250.0f)));
+    EXPECT_TRUE(growing.move(Point(300.0f, -250.0f), Point(-9000.0f, 4000.0f)));
+    EXPECT_TRUE(growing.commit());
+    EXPECT_TRUE(Journal::read(logPath + ".growing", records));
+    EXPECT_EQ(records.size(), 2u);
+    std::remove((logPath + ".growing").c_str());
+}
+
+// Test a snapshot bounds recovery to the records logged after it
+TEST_F(DurableQuadTreeTest, SnapshotBoundsReplay) {
+    size_t replayed = 0;
+    std::vector<Point> expected;
+    {
+        auto tree = open(replayed);
+        for (int i = 0; i < 1000; ++i) EXPECT_TRUE(tree->insert(pointAt(i)));
+        EXPECT_TRUE(tree->snapshot());
+        for (int i = 0; i < 10; ++i) EXPECT_TRUE(tree->remove(pointAt(i)));
+        for (int i = 1000; i < 1020; ++i) EXPECT_TRUE(tree->insert(pointAt(i)));
+        EXPECT_TRUE(tree->commit());
+        expected = contents(tree->tree());
+    }
+    auto recovered = open(replayed);
+    EXPECT_EQ(replayed, 30u);
+    EXPECT_EQ(contents(recovered->tree()), expected);
+
+    // The recovered tree keeps logging where the old one stopped
+    EXPECT_TRUE(recovered->insert(Point(1.25f, 1.25f)));
+    EXPECT_TRUE(recovered->commit());
+    expected = contents(recovered->tree());
+    recovered.reset();
+    EXPECT_EQ(contents(open(replayed)->tree()), expected);
+    EXPECT_EQ(replayed, 31u);
+}
+
+// Test a log that was not emptied after its snapshot does not apply updates twice
+TEST_F(DurableQuadTreeTest, StaleLogAfterSnapshot) {
+    size_t replayed = 0;
+    std::vector<Point> expected;
+    {
+        auto tree = open(replayed);
+        for (int i = 0; i < 50; ++i) EXPECT_TRUE(tree->insert(pointAt(i)));
+        EXPECT_TRUE(tree->commit());
+        std::ifstream log(logPath, std::ios::binary);
+        const std::string before((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+
+        EXPECT_TRUE(tree->snapshot());
+        expected = contents(tree->tree());
+        tree.reset();
+
+        // As if the crash came between renaming the snapshot and emptying the log
+        std::ofstream(logPath, std::ios::binary) << before;
+    }
+    auto recovered = open(replayed);
+    EXPECT_EQ(replayed, 0u);
+    EXPECT_EQ(contents(recovered->tree()), expected);
+}
+
+// Test a torn record at the end of the log is dropped and overwritten by later appends
+TEST_F(DurableQuadTreeTest, TornTail) {
+    size_t replayed = 0;
+    {
+        auto tree = open(replayed);
+        for (int i = 0; i < 20; ++i) EXPECT_TRUE(tree->insert(pointAt(i)));
+        EXPECT_TRUE(tree->commit());
+    }
+    std::ofstream(logPath, std::ios::binary | std::ios::app) << std::string(Journal::RECORD_SIZE - 7, '\x5a');
+
+    auto recovered = open(replayed);
+    EXPECT_EQ(replayed, 20u);
+    EXPECT_TRUE(recovered->insert(Point(3.0f, 3.0f)));
+    EXPECT_TRUE(recovered->commit());
+
+    std::vector<JournalRecord> records;
+    EXPECT_TRUE(Journal::read(logPath, records));
+    ASSERT_EQ(records.size(), 21u);
+    EXPECT_EQ(records.back().sequence, 21u);
+    EXPECT_EQ(records.back().to, Point(3.0f, 3.0f));
+}
+
+// Test records reach the file a whole group at a time
+TEST_F(DurableQuadTreeTest, GroupCommit) {
+    Journal journal;
+    std::vector<JournalRecord> records;
+    EXPECT_TRUE(journal.open(logPath, Journal::Options{4, 0}, 1, records));
+    EXPECT_TRUE(records.empty());
+
+    for (int i = 0; i < 3; ++i) EXPECT_TRUE(journal.append(JournalRecord::Op::Insert, Point(), pointAt(i)));
+    EXPECT_TRUE(Journal::read(logPath, records));
+    EXPECT_TRUE(records.empty());  // Still buffered
+
+    EXPECT_TRUE(journal.append(JournalRecord::Op::Move, pointAt(0), pointAt(3)));
+    EXPECT_TRUE(Journal::read(logPath, records));
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[3].op, JournalRecord::Op::Move);
+    EXPECT_EQ(records[3].from, pointAt(0));
+    EXPECT_EQ(records[3].to.payload, 3.0f);
+
+    EXPECT_TRUE(journal.append(JournalRecord::Op::Remove, Point(), pointAt(1)));
+    EXPECT_TRUE(journal.sync());
+    EXPECT_TRUE(Journal::read(logPath, records));
+    EXPECT_EQ(records.size(), 5u);
+    EXPECT_EQ(journal.nextSequence(), 6u);
+}
+
+// Test a failed group write poisons the journal: nothing of the group or later appends reaches the file
+TEST_F(DurableQuadTreeTest, JournalWriteFailure) {
+    Journal journal;
+    std::vector<JournalRecord> records;
+    ASSERT_TRUE(journal.open(logPath, Journal::Options{4, 0}, 1, records));
+    for (int i = 0; i < 3; ++i) EXPECT_TRUE(journal.append(JournalRecord::Op::Insert, Point(), pointAt(i)));
+
+    makeUnwritable(logPath);
+    EXPECT_FALSE(journal.append(JournalRecord::Op::Insert, Point(), pointAt(3))); // Completes the group
+    EXPECT_TRUE(journal.hasFailed());
+    EXPECT_FALSE(journal.isOpen());
+    EXPECT_FALSE(journal.append(JournalRecord::Op::Insert, Point(), pointAt(4)));
+    EXPECT_FALSE(journal.sync());
+    journal.close(); // Writes nothing
+    EXPECT_TRUE(Journal::read(logPath, records));
+    EXPECT_TRUE(records.empty());
+
+    // Reopening clears the failure
+    ASSERT_TRUE(journal.open(logPath, Journal::Options{1, 1}, 1, records));
+    EXPECT_FALSE(journal.hasFailed());
+    EXPECT_TRUE(journal.append(JournalRecord::Op::Insert, Point(), pointAt(5)));
+    EXPECT_TRUE(Journal::read(logPath, records));
+    EXPECT_EQ(records.size(), 1u);
+}
+
+// Test a tree whose log cannot be written refuses every later update and recovers what the log holds
+TEST_F(DurableQuadTreeTest, LogWriteFailure) {
+    size_t replayed = 0;
+    auto tree = open(replayed, Journal::Options{1, 1});
+    EXPECT_TRUE(tree->insert(pointAt(0)));
+    EXPECT_FALSE(tree->failed());
+
+    makeUnwritable(logPath);
+    EXPECT_FALSE(tree->insert(pointAt(1)));
+    EXPECT_TRUE(tree->failed());
+    EXPECT_FALSE(tree->insert(pointAt(2)));
+    EXPECT_FALSE(tree->move(pointAt(0), pointAt(3)));
+    EXPECT_FALSE(tree->commit());
+    EXPECT_FALSE(tree->snapshot());
+    EXPECT_EQ(contents(tree->tree()), std::vector<Point>{pointAt(0)});
+
+    tree = open(replayed);
+    EXPECT_EQ(replayed, 1u);
+    EXPECT_EQ(contents(tree->tree()), std::vector<Point>{pointAt(0)});
+}
@@ -0,0 +1,63 @@
+#include "HybridQuadTree.hpp"
+
+#include <algorithm>
+
+// Constructor for the HybridQuadTree, creates one empty QuadTree per grid cell
+HybridQuadTree::HybridQuadTree(const Rect &boundary, const int levels)
+    : boundary(boundary), side(levels >= 0 && levels <= MAX_LEVELS ? 1 << levels : 0),
+      left(boundary.x - boundary.w), top(boundary.y - boundary.h),
+      cellWidth(2 * boundary.w / static_cast<float>(std::max(side, 1))), cellHeight(2 * boundary.h / static_cast<float>(std::max(side, 1))),
+      inverseCellWidth(static_cast<float>(side) / (2 * boundary.w)), inverseCellHeight(static_cast<float>(side) / (2 * boundary.h)) {
+    // Grid lines, with the outermost ones taken from the boundary itself
+    auto line = [&](const float low, const float high, const float step, const int i) {
+        return i == 0 ? low : i == side ? high : low + static_cast<float>(i) * step;
+    };
+    cells.reserve(static_cast<size_t>(side) * static_cast<size_t>(side));
+    for (int row = 0; row < side; ++row) {
+        const float cellTop = line(top, boundary.y + boundary.h, cellHeight, row);
+        const float cellBottom = line(top, boundary.y + boundary.h, cellHeight, row + 1);
+        for (int column = 0; column < side; ++column) {
+            const float cellLeft = line(left, boundary.x + boundary.w, cellWidth, column);
+            const float cellRight = line(left, boundary.x + boundary.w, cellWidth, column + 1);
+            cells.emplace_back(rectBetween(cellLeft, cellRight, cellTop, cellBottom));
+        }
+    }
+    counts.assign(cells.size(), 0);
+}
+
+const Rect &HybridQuadTree::getBoundary() const {
+    return boundary;
+}
+
+int HybridQuadTree::cellsPerSide() const {
+    return side;
+}
+
+int HybridQuadTree::size() const {
+    int count = 0;
+    for (const int c : counts) count += c;
+    return count;
+}
+
+// Finds the cell from the coordinates, then lets the cell boundaries settle points on a shared edge
+int HybridQuadTree::cellIndex(const Point &point) const {
+    if (side == 0 || !boundary.contains(point)) return -1;
+
+    int column = std::clamp(static_cast<int>((point.x - left) * inverseCellWidth), 0, side - 1);
+    int row = std::clamp(static_cast<int>((point.y - top) * inverseCellHeight), 0, side - 1);
+
+    // The multiplication can round a point just across an edge; step back into the cell whose boundary holds it
+    const Rect &cell = cells[static_cast<size_t>(row * side + column)].getBoundary();
+    if (point.x < cell.x - cell.w && column > 0) --column;
+    else if (point.x > cell.x + cell.w && column < side - 1) ++column;
+    if (point.y < cell.y - cell.h && row > 0) --row;
+    else if (point.y > cell.y + cell.h && row < side - 1) ++row;
+    return row * side + column;
+}
+
+bool HybridQuadTree::insert(const Point &point) {
+    const int index = cellIndex(point);
+    if (index < 0 || !cells[static_cast<size_t>(index)].insert(point)) return false;
+    ++counts[static_cast<size_t>(index)];
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef HYBRIDQUADTREE_H
+#define HYBRIDQUADTREE_H
+
+#include "QuadTree.hpp"
+
+#include <vector>
+
+// A fixed 2^levels x 2^levels grid of QuadTrees over one boundary. The cells stand in for the top levels
+// of a single tree, which on large maps cost every query a descent yet almost never prune anything: a
+// point's cell is addressed directly from its coordinates, and each cell's tree is that many levels shallower.
+// KNN starts in the target's cell and expands ring by ring over the neighbouring cells, sharing one bounded
+// heap across their trees, until the nearest unvisited cell is farther than the N-th neighbour.
+class HybridQuadTree {
+    Rect boundary;
+    int side; // Cells along each axis, 2^levels, or 0 when the levels were rejected
+    float left, top; // Coordinates of the first grid lines
+    float cellWidth, cellHeight;
+    float inverseCellWidth, inverseCellHeight;
+    std::vector<QuadTree> cells; // Row-major, row 0 at the top (smallest y); cell boundaries share their edges
+    std::vector<int> counts; // Points per cell, so empty cells are passed over without touching their trees
+
+    [[nodiscard]] int cellIndex(const Point &point) const; // Cell storing point, -1 if it is outside the boundary
+
+public:
+    static constexpr int MAX_LEVELS = 8; // 256 x 256 cells; every cell is a QuadTree allocated up front
+
+    // Constructor splitting boundary into 2^levels x 2^levels cells. Levels outside [0, MAX_LEVELS] are rejected:
+    // the tree gets no cells, cellsPerSide() returns 0 and every insert fails.
+    HybridQuadTree(const Rect &boundary, int levels);
+
+    [[nodiscard]] const Rect &getBoundary() const; // The area covered by all cells
+    [[nodiscard]] int cellsPerSide() const;
+    [[nodiscard]] int size() const; // Number of stored points
+
+    bool insert(const Point &point); // Insert into the cell holding point; false outside the boundary
+
+    // Visit every point inside range (edges included), over the cells it overlaps
+    template<typename Visitor>
+    void queryRange(const Rect &range, Visitor &&visitor) const;
+
+    // The N nearest points to target, nearest first, skipping target itself once like QuadTree::nearestNeighbors.
+    // Returns the number of points found.
+    template<size_t N>
+    size_t nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const;
+};
+
+#include "HybridQuadTree.tpp"
+
+#endif //HYBRIDQUADTREE_H
@@ -0,0 +1,97 @@
+#ifndef HYBRIDQUADTREE_TPP
+#define HYBRIDQUADTREE_TPP
+
+#include <algorithm>
+#include <limits>
+
+template<typename Visitor>
+void HybridQuadTree::queryRange(const Rect &range, Visitor &&visitor) const {
+    if (side == 0 || !boundary.intersects(range)) return;
+
+    // One cell of slack on each side covers rounding in the multiplication; the boundary test settles it
+    auto clampCell = [&](const float offset, const float inverse) {
+        return std::clamp(static_cast<int>(offset * inverse), 0, side - 1);
+    };
+    const int firstColumn = std::max(0, clampCell(range.x - range.w - left, inverseCellWidth) - 1);
+    const int lastColumn = std::min(side - 1, clampCell(range.x + range.w - left, inverseCellWidth) + 1);
+    const int firstRow = std::max(0, clampCell(range.y - range.h - top, inverseCellHeight) - 1);
+    const int lastRow = std::min(side - 1, clampCell(range.y + range.h - top, inverseCellHeight) + 1);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            const size_t index = static_cast<size_t>(row * side + column);
+            if (counts[index] == 0 || !cells[index].getBoundary().intersects(range)) continue;
+            cells[index].queryRange(range, visitor);
+        }
+    }
+}
+
+template<size_t N>
+size_t HybridQuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const {
+    // One node queue and one bounded max-heap per thread, shared by every cell a query visits
+    thread_local std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    thread_local std::vector<std::pair<float, Point>> nearestHeap;
+    if (side == 0) return 0;
+    nearestHeap.clear();
+    float maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false;
+
+    // Cells farther than the N-th neighbour found so far are skipped without entering their trees
+    auto visit = [&](const int column, const int row) {
+        const size_t index = static_cast<size_t>(row * side + column);
+        if (counts[index] == 0) return;
+        const QuadTree &cell = cells[index];
+        if (nearestHeap.size() == N && distanceSquared(target, cell.getBoundary()) > maxDist) return;
+        cell.gatherNearest<N>(target, maxDist, targetSkipped, nodeQueue, nearestHeap);
+    };
+
+    const int column = std::clamp(static_cast<int>((target.x - left) * inverseCellWidth), 0, side - 1);
+    const int row = std::clamp(static_cast<int>((target.y - top) * inverseCellHeight), 0, side - 1);
+    for (int ring = 0;; ++ring) {
+        const int firstColumn = column - ring, lastColumn = column + ring;
+        const int firstRow = row - ring, lastRow = row + ring;
+        if (ring == 0) {
+            visit(column, row);
+        } else {
+            // Top and bottom rows of the ring, then the columns on either side between them
+            for (int c = std::max(firstColumn, 0); c <= std::min(lastColumn, side - 1); ++c) {
+                if (firstRow >= 0) visit(c, firstRow);
+                if (lastRow < side) visit(c, lastRow);
+            }
+            for (int r = std::max(firstRow + 1, 0); r <= std::min(lastRow - 1, side - 1); ++r) {
+                if (firstColumn >= 0) visit(firstColumn, r);
+                if (lastColumn < side) visit(lastColumn, r);
+            }
+        }
+        if (firstColumn <= 0 && lastColumn >= side - 1 && firstRow <= 0 && lastRow >= side - 1) break; // Grid exhausted
+
+        // Every cell outside the rings so far lies beyond the nearest outer edge of the cells next to them
+        if (nearestHeap.size() == N) {
+            float escape = std::numeric_limits<float>::max();
+            if (firstColumn > 0) {
+                const Rect &next = cells[static_cast<size_t>(row * side + firstColumn - 1)].getBoundary();
+                escape = std::min(escape, target.x - (next.x + next.w));
+            }
+            if (lastColumn < side - 1) {
+                const Rect &next = cells[static_cast<size_t>(row * side + lastColumn + 1)].getBoundary();
+                escape = std::min(escape, (next.x - next.w) - target.x);
+            }
+            if (firstRow > 0) {
+                const Rect &next = cells[static_cast<size_t>((firstRow - 1) * side + column)].getBoundary();
+                escape = std::min(escape, target.y - (next.y + next.h));
+            }
+            if (lastRow < side - 1) {
+                const Rect &next = cells[static_cast<size_t>((lastRow + 1) * side + column)].getBoundary();
+                escape = std::min(escape, (next.y - next.h) - target.y);
+            }
+            if (escape > 0.0f && escape * escape > maxDist) break;
+        }
+    }
+
+    std::sort(nearestHeap.begin(), nearestHeap.end()); // A heap only once N candidates were found
+    for (size_t i = 0; i < nearestHeap.size(); ++i) {
+        nearest[i] = nearestHeap[i].second;
+    }
+    return nearestHeap.size();
+}
+
+#endif // HYBRIDQUADTREE_TPP
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "HybridQuadTree.hpp"
+#include "SpatialIndex.hpp"
+#include "TestHelpers.hpp"
+
+static_assert(SpatialIndex<HybridQuadTree>);
+
+class HybridQuadTreeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create an 8x8 grid of trees covering a 120x90 area centered at (0,0)
+        tree = std::make_unique<HybridQuadTree>(Rect(0.0f, 0.0f, 60.0f, 45.0f), 3);
+    }
+
+    // Fill a tree with a lattice whose points land on cell edges as well as inside cells, plus duplicates
+    static std::vector<Point> insertLattice(HybridQuadTree &target) {
+        std::vector<Point> inserted;
+        for (int i = -60; i <= 60; i += 3) {
+            for (int j = -45; j <= 45; j += 5) {
+                inserted.emplace_back(static_cast<float>(i) + 0.5f * static_cast<float>(j % 2), static_cast<float>(j), static_cast<float>(i + j));
+            }
+        }
+        for (int k = 0; k < 30; ++k) inserted.emplace_back(7.5f, -11.25f, static_cast<float>(k));
+        std::erase_if(inserted, [&](const Point &p) { return !target.getBoundary().contains(p); });
+        for (const Point &p : inserted) EXPECT_TRUE(target.insert(p));
+        return inserted;
+    }
+
+    std::unique_ptr<HybridQuadTree> tree;
+};
+
+// Test routing points to cells, including cell and boundary edges
+TEST_F(HybridQuadTreeTest, InsertRouting) {
+    EXPECT_EQ(tree->cellsPerSide(), 8);
+    EXPECT_TRUE(tree->insert(Point(0.0f, 0.0f)));     // Corner shared by four cells
+    EXPECT_TRUE(tree->insert(Point(-15.0f, 11.25f))); // Corner of cells away from the centre
+    EXPECT_TRUE(tree->insert(Point(60.0f, 45.0f)));   // Boundary corner, edges included
+    EXPECT_FALSE(tree->insert(Point(60.5f, 0.0f)));   // Outside the boundary
+    EXPECT_EQ(tree->size(), 3);
+
+    int hits = 0;
+    tree->queryRange(Rect(0.0f, 0.0f, 0.0f, 0.0f), [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 1); // Stored exactly once
+}
+
+// Test that grids deeper than MAX_LEVELS, or negative levels, are rejected rather than allocated
+TEST_F(HybridQuadTreeTest, RejectedLevels) {
+    EXPECT_EQ(HybridQuadTree(Rect(0.0f, 0.0f, 60.0f, 45.0f), HybridQuadTree::MAX_LEVELS).cellsPerSide(), 1 << HybridQuadTree::MAX_LEVELS);
+    for (const int levels : { HybridQuadTree::MAX_LEVELS + 1, 12, -1 }) {
+        HybridQuadTree rejected(Rect(0.0f, 0.0f, 60.0f, 45.0f), levels);
+        EXPECT_EQ(rejected.cellsPerSide(), 0);
+        EXPECT_FALSE(rejected.insert(Point(1.0f, 2.0f)));
+        EXPECT_EQ(rejected.size(), 0);
+
+        int hits = 0;
+        rejected.queryRange(Rect(0.0f, 0.0f, 60.0f, 45.0f), [&](const Point &) { ++hits; });
+        EXPECT_EQ(hits, 0);
+        std::array<Point, 3> nearest;
+        EXPECT_EQ(rejected.nearestNeighbors<3>(Point(1.0f, 2.0f), nearest), 0u);
+    }
+}
+
+// Test range queries against a brute-force scan
+TEST_F(HybridQuadTreeTest, QueryRange) {
+    const std::vector<Point> inserted = insertLattice(*tree);
+    for (const Rect &range : { Rect(0.0f, 0.0f, 60.0f, 45.0f), Rect(7.5f, -11.25f, 0.0f, 0.0f), Rect(-31.0f, 20.0f, 14.0f, 9.0f),
+                               Rect(59.0f, -44.0f, 30.0f, 3.0f) }) {
+        std::vector<Point> found, expected;
+        tree->queryRange(range, [&](const Point &p) { found.push_back(p); });
+        for (const Point &p : inserted) {
+            if (range.contains(p)) expected.push_back(p);
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+// Test nearest neighbors against a brute-force scan at several grid resolutions
+TEST_F(HybridQuadTreeTest, NearestNeighbors) {
+    for (const int levels : { 0, 1, 3, 5 }) {
+        HybridQuadTree hybrid(Rect(0.0f, 0.0f, 60.0f, 45.0f), levels);
+        const std::vector<Point> inserted = insertLattice(hybrid);
+
+        std::array<Point, 12> nearest;
+        for (const Point &target : { Point(1.0f, 2.0f), Point(7.5f, -11.25f), Point(-60.0f, 45.0f), Point(30.0f, 0.0f),
+                                     Point(100.0f, -80.0f) }) {
+            const std::vector<float> distances = bruteForce<12>(inserted, target);
+            ASSERT_EQ(hybrid.nearestNeighbors<12>(target, nearest), nearest.size());
+            for (size_t i = 0; i < nearest.size(); ++i) {
+                EXPECT_EQ(distanceSquared(target, nearest[i]), distances[i]) << "levels " << levels;
+            }
+        }
+    }
+}
+
+// Test asking for more neighbours than there are points
+TEST_F(HybridQuadTreeTest, NearestNeighborsFewPoints) {
+    std::array<Point, 4> nearest;
+    EXPECT_EQ(tree->nearestNeighbors<4>(Point(0.0f, 0.0f), nearest), 0u);
+
+    EXPECT_TRUE(tree->insert(Point(-50.0f, -40.0f)));
+    EXPECT_TRUE(tree->insert(Point(50.0f, 40.0f)));
+    EXPECT_TRUE(tree->insert(Point(1.0f, 1.0f)));
+    EXPECT_EQ(tree->nearestNeighbors<4>(Point(1.0f, 1.0f), nearest), 2u);  // The target itself is skipped
+    EXPECT_EQ(tree->nearestNeighbors<4>(Point(40.0f, 30.0f), nearest), 3u);
+    EXPECT_EQ(nearest[0], Point(50.0f, 40.0f));
+    EXPECT_EQ(nearest[2], Point(-50.0f, -40.0f));
+}
@@ -0,0 +1,197 @@
+#include "Journal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// FNV-1a over the record body, enough to tell a torn or unwritten record from a complete one
+static uint32_t checksum(const unsigned char *bytes, const size_t count) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < count; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Layout: sequence (8), op (4), from x/y/payload (12), to x/y/payload (12), checksum (4), in host byte order
+static void encode(const JournalRecord &record, unsigned char *out) {
+    const uint32_t op = static_cast<uint32_t>(record.op);
+    const float coords[6] = {record.from.x, record.from.y, record.from.payload, record.to.x, record.to.y, record.to.payload};
+    std::memcpy(out, &record.sequence, 8);
+    std::memcpy(out + 8, &op, 4);
+    std::memcpy(out + 12, coords, 24);
+    const uint32_t sum = checksum(out, Journal::RECORD_SIZE - 4);
+    std::memcpy(out + 36, &sum, 4);
+}
+
+static bool decode(const unsigned char *in, JournalRecord &record) {
+    uint32_t sum, op;
+    std::memcpy(&sum, in + 36, 4);
+    if (sum != checksum(in, Journal::RECORD_SIZE - 4)) return false;
+    std::memcpy(&op, in + 8, 4);
+    if (op < 1 || op > 3) return false;
+
+    float coords[6];
+    std::memcpy(&record.sequence, in, 8);
+    std::memcpy(coords, in + 12, 24);
+    record.op = static_cast<JournalRecord::Op>(op);
+    record.from = Point(coords[0], coords[1], coords[2]);
+    record.to = Point(coords[3], coords[4], coords[5]);
+    return true;
+}
+
+// Writes all of bytes, resuming after partial writes and signals
+static bool writeAll(const int fd, const unsigned char *bytes, size_t count) {
+    while (count > 0) {
+        const ssize_t written = ::write(fd, bytes, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        count -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::read(const std::string &path, std::vector<JournalRecord> &records) {
+    records.clear();
+    const int in = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return errno == ENOENT;
+
+    // Read in large chunks; a record may straddle two of them
+    std::vector<unsigned char> buffer(RECORD_SIZE * 4096);
+    size_t filled = 0;
+    bool ok = true, valid = true;
+    uint64_t previous = 0;
+    while (valid) {
+        const ssize_t got = ::read(in, buffer.data() + filled, buffer.size() - filled);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        if (got == 0) break; // A partial record left in the buffer is a torn tail
+        filled += static_cast<size_t>(got);
+
+        size_t offset = 0;
+        for (; offset + RECORD_SIZE <= filled; offset += RECORD_SIZE) {
+            JournalRecord record;
+            // Stop at a bad checksum or at a sequence that goes backwards, i.e. stale bytes past a torn write
+            if (!decode(buffer.data() + offset, record) || record.sequence <= previous) {
+                valid = false;
+                break;
+            }
+            previous = record.sequence;
+            records.push_back(record);
+        }
+        std::memmove(buffer.data(), buffer.data() + offset, filled - offset);
+        filled -= offset;
+    }
+    ::close(in);
+    return ok;
+}
+
+bool Journal::open(const std::string &path, const Options &options, const uint64_t firstSequence, std::vector<JournalRecord> &records) {
+    close();
+    failed = false;
+    if (!read(path, records)) return false;
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    // Drop a torn tail so new records directly follow the valid ones
+    const off_t validBytes = static_cast<off_t>(records.size() * RECORD_SIZE);
+    if (::ftruncate(fd, validBytes) != 0 || ::lseek(fd, validBytes, SEEK_SET) != validBytes) {
+        close();
+        return false;
+    }
+
+    this->options = options;
+    this->options.groupSize = std::max<size_t>(1, options.groupSize);
+    sequence = std::max(firstSequence, records.empty() ? uint64_t{1} : records.back().sequence + 1);
+    pending.clear();
+    pending.reserve(this->options.groupSize * RECORD_SIZE);
+    unsyncedGroups = 0;
+    return true;
+}
+
+void Journal::close() {
+    if (fd < 0) return;
+    if (!writeAll(fd, pending.data(), pending.size())) {
+        fail();
+        return;
+    }
+    pending.clear();
+    ::close(fd);
+    fd = -1;
+}
+
+bool Journal::isOpen() const {
+    return fd >= 0;
+}
+
+bool Journal::hasFailed() const {
+    return failed;
+}
+
+bool Journal::fail() {
+    pending.clear();
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    failed = true;
+    return false;
+}
+
+bool Journal::append(const JournalRecord::Op op, const Point &from, const Point &to) {
+    if (fd < 0) return false;
+
+    JournalRecord record;
+    record.sequence = sequence++;
+    record.op = op;
+    record.from = from;
+    record.to = to;
+    const size_t offset = pending.size();
+    pending.resize(offset + RECORD_SIZE);
+    encode(record, pending.data() + offset);
+
+    return pending.size() < options.groupSize * RECORD_SIZE || writeGroup();
+}
+
+bool Journal::writeGroup() {
+    if (!writeAll(fd, pending.data(), pending.size())) return fail();
+    pending.clear();
+    if (options.syncEvery > 0 && ++unsyncedGroups >= options.syncEvery) {
+        unsyncedGroups = 0;
+        if (::fdatasync(fd) != 0) return fail();
+    }
+    return true;
+}
+
+bool Journal::sync() {
+    if (fd < 0) return false;
+    if (!writeAll(fd, pending.data(), pending.size())) return fail();
+    pending.clear();
+    unsyncedGroups = 0;
+    return ::fdatasync(fd) == 0 || fail();
+}
+
+bool Journal::reset() {
+    if (!sync()) return false;
+    return (::ftruncate(fd, 0) == 0 && ::lseek(fd, 0, SEEK_SET) == 0 && ::fdatasync(fd) == 0) || fail();
+}
+
+uint64_t Journal::nextSequence() const {
+    return sequence;
+}
+
+uint64_t Journal::lastSequence() const {
+    return sequence - 1;
+}
@@ -0,0 +1,74 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "QuadTree.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One logged QuadTree update. Insert and Remove use to alone; Move goes from -> to. Points keep their payload,
+// which with the coordinates identifies the stored point a Remove or Move applies to.
+struct JournalRecord {
+    enum class Op : uint32_t { Insert = 1, Remove = 2, Move = 3 };
+
+    uint64_t sequence = 0; // Strictly increasing across the life of a log, never reset by snapshots
+    Op op = Op::Insert;
+    Point from;
+    Point to;
+};
+
+// Append-only binary log of fixed-size, checksummed records written with POSIX write/fsync.
+// Records are buffered and written in groups of groupSize with one write call (group commit), and the file
+// is fsynced after every syncEvery groups, trading the loss window of a crash for fewer flushes to disk.
+// A crash can leave a torn record at the end; reading stops at the first record whose checksum fails, and
+// open cuts the file back to that point before appending.
+// A failed write or fsync poisons the journal: the pending group is dropped and the file closed without
+// another write, so a retry can neither duplicate a partly written group nor log records behind a lost one.
+// The records of the failed group, and any not yet fsynced, may or may not be on disk until it is reopened.
+class Journal {
+public:
+    static constexpr size_t RECORD_SIZE = 40; // Sequence, op, two points and a checksum
+
+    struct Options {
+        size_t groupSize = 64; // Records buffered per write call, at least 1
+        size_t syncEvery = 1; // Groups written per fsync; 0 leaves flushing to the OS until sync()
+    };
+
+    Journal() = default;
+    ~Journal(); // Writes the pending group, without an fsync, and closes the file unless the journal failed
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    // Open or create the log at path for appending, returning its valid records in records. Sequence numbers
+    // continue after both the last record and firstSequence. False if the file cannot be opened or repaired.
+    bool open(const std::string &path, const Options &options, uint64_t firstSequence, std::vector<JournalRecord> &records);
+    void close();
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] bool hasFailed() const; // A write or fsync failed since open; the journal is closed
+
+    // Buffer one record, writing the group once it is full. False if a write or fsync failed.
+    bool append(JournalRecord::Op op, const Point &from, const Point &to);
+
+    bool sync(); // Write the pending group and fsync, making every appended record durable
+    bool reset(); // Sync, then empty the log once a snapshot holds everything in it; sequences keep counting
+
+    [[nodiscard]] uint64_t nextSequence() const; // Sequence the next appended record gets
+    [[nodiscard]] uint64_t lastSequence() const; // Sequence of the last appended record, 0 if none
+
+    // The valid prefix of the log at path; a missing file reads as empty. False only on a read error.
+    static bool read(const std::string &path, std::vector<JournalRecord> &records);
+
+private:
+    int fd = -1;
+    Options options;
+    uint64_t sequence = 1; // Sequence of the next record
+    std::vector<unsigned char> pending; // Encoded records of the current group
+    size_t unsyncedGroups = 0; // Groups written since the last fsync
+    bool failed = false; // Set by fail(), cleared by open()
+
+    bool writeGroup(); // Write the pending group in one call, fsyncing when syncEvery groups are due
+    bool fail(); // Drop the pending group and close the file without writing it; returns false
+};
+
+#endif //JOURNAL_H
@@ -0,0 +1,141 @@
+#include "LooseQuadTree.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+// Constructor for the LooseQuadTree, initializes with the root cell
+LooseQuadTree::LooseQuadTree(const Rect &boundary) : boundary(boundary) {}
+
+// Creates the four child cells; children are created together so every quadrant has a node. Like
+// QuadTree::quadrantRect they are spanned between the parent's edges and its centre lines, which childFor
+// compares against, so an item centre routed to a child is inside its cell and hence its loose bounds.
+void LooseQuadTree::subdivide() {
+    const float left = boundary.x - boundary.w, right = boundary.x + boundary.w;
+    const float top = boundary.y - boundary.h, bottom = boundary.y + boundary.h;
+
+    northeast = std::make_unique<LooseQuadTree>(rectBetween(boundary.x, right, top, boundary.y));
+    northwest = std::make_unique<LooseQuadTree>(rectBetween(left, boundary.x, top, boundary.y));
+    southeast = std::make_unique<LooseQuadTree>(rectBetween(boundary.x, right, boundary.y, bottom));
+    southwest = std::make_unique<LooseQuadTree>(rectBetween(left, boundary.x, boundary.y, bottom));
+    for (LooseQuadTree* child : { northeast.get(), northwest.get(), southeast.get(), southwest.get() }) {
+        child->depth = depth + 1;
+    }
+    divided = true;
+}
+
+Rect LooseQuadTree::looseBounds() const {
+    return Rect(boundary.x, boundary.y, boundary.w * LOOSENESS, boundary.h * LOOSENESS);
+}
+
+// An item whose centre is in a child's cell stays inside that child's loose bounds if its half extents
+// do not exceed the slack (LOOSENESS - 1) times the child's half size
+bool LooseQuadTree::fitsChild(const Rect &item) const {
+    return depth < MAX_DEPTH &&
+           item.w <= (LOOSENESS - 1.0f) * boundary.w / 2 &&
+           item.h <= (LOOSENESS - 1.0f) * boundary.h / 2;
+}
+
+// Picks the quadrant of the item's centre, with the same tie-breaking as QuadTree::insert (east, then north)
+LooseQuadTree* LooseQuadTree::childFor(const Rect &item) const {
+    const bool east = item.x >= boundary.x;
+    const bool north = item.y <= boundary.y;
+    if (north) return east ? northeast.get() : northwest.get();
+    return east ? southeast.get() : southwest.get();
+}
+
+// Descends straight to the item's node, guided only by its size and centre
+bool LooseQuadTree::insert(const Rect &item) {
+    if (!boundary.contains(Point(item.x, item.y)) ||
+        item.w > (LOOSENESS - 1.0f) * boundary.w || item.h > (LOOSENESS - 1.0f) * boundary.h) {
+        return false; // Centre outside the root cell, or too large for the root's loose bounds
+    }
+
+    LooseQuadTree* node = this;
+    while (node->fitsChild(item)) {
+        ++node->subtreeCount;
+        if (!node->divided) node->subdivide();
+        node = node->childFor(item);
+    }
+    ++node->subtreeCount;
+    node->items.push_back(item);
+    return true;
+}
+
+// Follows the same path as insert, so only the nodes on it are touched
+bool LooseQuadTree::remove(const Rect &item) {
+    std::array<LooseQuadTree*, MAX_DEPTH + 1> path{};
+    int length = 0;
+
+    LooseQuadTree* node = this;
+    path[length++] = node;
+    while (node->divided && node->fitsChild(item)) {
+        node = node->childFor(item);
+        path[length++] = node;
+    }
+
+    const auto it = std::ranges::find(node->items, item);
+    if (it == node->items.end()) return false;
+    *it = node->items.back(); // Order within a node does not matter
+    node->items.pop_back();
+
+    for (int i = 0; i < length; ++i) {
+        --path[i]->subtreeCount;
+    }
+    // Release child nodes of the highest subtree that became empty
+    for (int i = 0; i < length; ++i) {
+        if (path[i]->subtreeCount == 0 && path[i]->divided) {
+            path[i]->northeast.reset();
+            path[i]->northwest.reset();
+            path[i]->southeast.reset();
+            path[i]->southwest.reset();
+            path[i]->divided = false;
+            break;
+        }
+    }
+    return true;
+}
+
+bool LooseQuadTree::update(const Rect &from, const Rect &to) {
+    if (!remove(from)) return false;
+    if (insert(to)) return true;
+    insert(from); // Keep the item where it was if the new bounds do not fit the tree
+    return false;
+}
+
+int LooseQuadTree::size() const {
+    return subtreeCount;
+}
+
+// Best-first search over nodes ordered by the distance to their loose bounds
+bool LooseQuadTree::nearest(const Point &target, Rect &result) const {
+    using Entry = std::pair<float, const LooseQuadTree*>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> nodeQueue;
+    float best = std::numeric_limits<float>::max();
+    bool found = false;
+
+    if (subtreeCount > 0) nodeQueue.emplace(0.0f, this);
+    while (!nodeQueue.empty()) {
+        const auto [distance, node] = nodeQueue.top();
+        nodeQueue.pop();
+        if (found && distance >= best) break; // No remaining node can hold a closer item
+
+        for (const Rect &item : node->items) {
+            const float dist = distanceSquared(target, item);
+            if (!found || dist < best) {
+                best = dist;
+                result = item;
+                found = true;
+            }
+        }
+
+        if (node->divided) {
+            for (const LooseQuadTree* child : { node->northeast.get(), node->northwest.get(), node->southeast.get(), node->southwest.get() }) {
+                if (child->subtreeCount == 0) continue;
+                const float minDist = distanceSquared(target, child->looseBounds());
+                if (!found || minDist < best) nodeQueue.emplace(minDist, child);
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,66 @@
+#ifndef LOOSEQUADTREE_H
+#define LOOSEQUADTREE_H
+
+#include "QuadTree.hpp"
+
+#include <memory>
+#include <vector>
+
+// Loose quadtree storing rectangles (x, y centre, w, h half extents) instead of points.
+// Every node's loose bounds are its cell enlarged by LOOSENESS, so an item is kept in exactly one node:
+// the deepest one whose cell holds the item's centre and whose loose bounds still hold the whole item.
+// That node is found from the item's size and centre alone, so insert and remove cost O(depth).
+class LooseQuadTree {
+    static constexpr float LOOSENESS = 2.0f; // Loose bounds are twice the cell, so items up to the cell size fit
+    static constexpr int MAX_DEPTH = 16; // Items smaller than the deepest cell stay at this depth
+    Rect boundary; // The cell this node represents
+    std::vector<Rect> items; // Items whose loose fit stops at this node
+    int depth = 0; // Depth of this node below the root
+    int subtreeCount = 0; // Number of items stored in this subtree
+    bool divided = false; // Flag indicating if the node has child nodes
+
+    // Child LooseQuadTree nodes (subdivisions)
+    std::unique_ptr<LooseQuadTree> northeast;
+    std::unique_ptr<LooseQuadTree> northwest;
+    std::unique_ptr<LooseQuadTree> southeast;
+    std::unique_ptr<LooseQuadTree> southwest;
+
+    void subdivide(); // Create the four child nodes
+
+    [[nodiscard]] Rect looseBounds() const; // The cell enlarged by LOOSENESS
+    [[nodiscard]] bool fitsChild(const Rect &item) const; // Check if item is small enough for a child's loose bounds
+    [[nodiscard]] LooseQuadTree* childFor(const Rect &item) const; // Child whose cell holds the item's centre
+
+    template<typename Visitor>
+    void visitAll(Visitor &visitor) const; // Emit every item of this subtree without testing it
+
+public:
+    explicit LooseQuadTree(const Rect &boundary); // Constructor initializing the tree with the root cell
+
+    // Insert an item; fails if its centre is outside the root cell or it does not fit the root's loose bounds
+    bool insert(const Rect &item);
+
+    bool remove(const Rect &item); // Remove one item equal to item, false if it is not stored
+    bool update(const Rect &from, const Rect &to); // Move an item to new bounds in O(depth)
+
+    [[nodiscard]] int size() const; // Number of stored items
+
+    // Visit every item overlapping range (edges included)
+    template<typename Visitor>
+    void queryIntersecting(const Rect &range, Visitor &&visitor) const;
+
+    // Visit every item lying entirely inside range; subtrees whose loose bounds are inside are emitted untested
+    template<typename Visitor>
+    void queryContainedIn(const Rect &range, Visitor &&visitor) const;
+
+    // Visit every item containing the point
+    template<typename Visitor>
+    void queryContaining(const Point &point, Visitor &&visitor) const;
+
+    // Nearest item to target by point-to-box distance (zero when inside); false if the tree is empty
+    bool nearest(const Point &target, Rect &result) const;
+};
+
+#include "LooseQuadTree.tpp"
+
+#endif //LOOSEQUADTREE_H
@@ -0,0 +1,70 @@
+#ifndef LOOSEQUADTREE_TPP
+#define LOOSEQUADTREE_TPP
+
+template<typename Visitor>
+void LooseQuadTree::visitAll(Visitor &visitor) const {
+    if (subtreeCount == 0) return;
+    for (const Rect &item : items) visitor(item);
+    if (divided) {
+        northeast->visitAll(visitor);
+        northwest->visitAll(visitor);
+        southeast->visitAll(visitor);
+        southwest->visitAll(visitor);
+    }
+}
+
+// Only nodes whose loose bounds overlap the range can hold an overlapping item
+template<typename Visitor>
+void LooseQuadTree::queryIntersecting(const Rect &range, Visitor &&visitor) const {
+    if (subtreeCount == 0 || !looseBounds().intersects(range)) return;
+
+    for (const Rect &item : items) {
+        if (item.intersects(range)) visitor(item);
+    }
+    if (divided) {
+        northeast->queryIntersecting(range, visitor);
+        northwest->queryIntersecting(range, visitor);
+        southeast->queryIntersecting(range, visitor);
+        southwest->queryIntersecting(range, visitor);
+    }
+}
+
+template<typename Visitor>
+void LooseQuadTree::queryContainedIn(const Rect &range, Visitor &&visitor) const {
+    if (subtreeCount == 0) return;
+    const Rect loose = looseBounds();
+    if (!loose.intersects(range)) return;
+
+    // Every item of the subtree lies within its loose bounds
+    if (range.contains(loose)) {
+        visitAll(visitor);
+        return;
+    }
+
+    for (const Rect &item : items) {
+        if (range.contains(item)) visitor(item);
+    }
+    if (divided) {
+        northeast->queryContainedIn(range, visitor);
+        northwest->queryContainedIn(range, visitor);
+        southeast->queryContainedIn(range, visitor);
+        southwest->queryContainedIn(range, visitor);
+    }
+}
+
+template<typename Visitor>
+void LooseQuadTree::queryContaining(const Point &point, Visitor &&visitor) const {
+    if (subtreeCount == 0 || !looseBounds().contains(point)) return;
+
+    for (const Rect &item : items) {
+        if (item.contains(point)) visitor(item);
+    }
+    if (divided) {
+        northeast->queryContaining(point, visitor);
+        northwest->queryContaining(point, visitor);
+        southeast->queryContaining(point, visitor);
+        southwest->queryContaining(point, visitor);
+    }
+}
+
+#endif // LOOSEQUADTREE_TPP
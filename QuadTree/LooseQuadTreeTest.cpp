@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include "LooseQuadTree.hpp"
+
+class LooseQuadTreeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create a LooseQuadTree covering a 100x100 area centered at (0,0)
+        tree = std::make_unique<LooseQuadTree>(Rect(0.0f, 0.0f, 50.0f, 50.0f));
+    }
+
+    // Fill the tree with a lattice of boxes of varying sizes and return them
+    std::vector<Rect> insertLattice() {
+        std::vector<Rect> boxes;
+        for (int i = -45; i <= 45; i += 9) {
+            for (int j = -45; j <= 45; j += 9) {
+                const float size = static_cast<float>((i * 7 + j * 3) % 11 + 11) / 4.0f;
+                boxes.emplace_back(static_cast<float>(i), static_cast<float>(j), size, size / 2.0f);
+                EXPECT_TRUE(tree->insert(boxes.back()));
+            }
+        }
+        return boxes;
+    }
+
+    std::unique_ptr<LooseQuadTree> tree;
+};
+
+// Test inserting boxes inside and outside the root cell
+TEST_F(LooseQuadTreeTest, InsertBox) {
+    EXPECT_TRUE(tree->insert(Rect(10.0f, 10.0f, 1.0f, 1.0f)));    // Small box
+    EXPECT_TRUE(tree->insert(Rect(45.0f, 45.0f, 20.0f, 20.0f)));  // Sticks out of the root cell but fits the loose bounds
+    EXPECT_FALSE(tree->insert(Rect(60.0f, 0.0f, 1.0f, 1.0f)));    // Centre outside the root cell
+    EXPECT_FALSE(tree->insert(Rect(0.0f, 0.0f, 60.0f, 1.0f)));    // Wider than the loose root
+    EXPECT_EQ(tree->size(), 2);
+}
+
+// Test intersection queries against a brute-force scan
+TEST_F(LooseQuadTreeTest, QueryIntersecting) {
+    const std::vector<Rect> boxes = insertLattice();
+    const Rect range(3.0f, -8.0f, 14.0f, 9.0f);
+
+    std::vector<Rect> found;
+    tree->queryIntersecting(range, [&](const Rect &box) { found.push_back(box); });
+
+    size_t expected = 0;
+    for (const Rect &box : boxes) {
+        if (box.intersects(range)) {
+            ++expected;
+            EXPECT_TRUE(std::ranges::find(found, box) != found.end());
+        }
+    }
+    EXPECT_EQ(found.size(), expected);
+}
+
+// Test containment queries against a brute-force scan
+TEST_F(LooseQuadTreeTest, QueryContainedIn) {
+    const std::vector<Rect> boxes = insertLattice();
+
+    for (const Rect &range : { Rect(0.0f, 0.0f, 50.0f, 50.0f), Rect(-10.0f, 12.0f, 20.0f, 15.0f) }) {
+        std::vector<Rect> found;
+        tree->queryContainedIn(range, [&](const Rect &box) { found.push_back(box); });
+
+        size_t expected = 0;
+        for (const Rect &box : boxes) {
+            if (range.contains(box)) ++expected;
+        }
+        EXPECT_EQ(found.size(), expected);
+        for (const Rect &box : found) {
+            EXPECT_TRUE(range.contains(box));
+        }
+    }
+}
+
+// Test point containment queries
+TEST_F(LooseQuadTreeTest, QueryContaining) {
+    tree->insert(Rect(0.0f, 0.0f, 10.0f, 10.0f));
+    tree->insert(Rect(5.0f, 5.0f, 1.0f, 1.0f));
+    tree->insert(Rect(-30.0f, -30.0f, 2.0f, 2.0f));
+
+    int hits = 0;
+    tree->queryContaining(Point(5.5f, 4.5f), [&](const Rect &) { ++hits; });
+    EXPECT_EQ(hits, 2);
+}
+
+// Test nearest-box queries against a brute-force scan
+TEST_F(LooseQuadTreeTest, NearestBox) {
+    const std::vector<Rect> boxes = insertLattice();
+
+    for (const Point &target : { Point(1.0f, 2.0f), Point(-49.0f, 30.0f), Point(22.0f, -41.0f) }) {
+        float best = std::numeric_limits<float>::max();
+        for (const Rect &box : boxes) best = std::min(best, distanceSquared(target, box));
+
+        Rect result;
+        ASSERT_TRUE(tree->nearest(target, result));
+        EXPECT_EQ(distanceSquared(target, result), best);
+    }
+}
+
+// Test nearest-box query on an empty tree
+TEST_F(LooseQuadTreeTest, NearestEmptyTree) {
+    Rect result;
+    EXPECT_FALSE(tree->nearest(Point(0.0f, 0.0f), result));
+}
+
+// Test removing and moving boxes
+TEST_F(LooseQuadTreeTest, RemoveAndUpdate) {
+    const std::vector<Rect> boxes = insertLattice();
+
+    EXPECT_TRUE(tree->remove(boxes[3]));
+    EXPECT_FALSE(tree->remove(boxes[3]));  // Already removed
+    EXPECT_EQ(tree->size(), static_cast<int>(boxes.size()) - 1);
+
+    const Rect moved(boxes[5].x + 1.0f, boxes[5].y, boxes[5].w, boxes[5].h);
+    EXPECT_TRUE(tree->update(boxes[5], moved));
+
+    int hits = 0;
+    tree->queryIntersecting(moved, [&](const Rect &box) { hits += box == moved; });
+    EXPECT_EQ(hits, 1);
+    tree->queryIntersecting(boxes[3], [&](const Rect &box) { EXPECT_NE(box, boxes[3]); });
+
+    for (const Rect &box : boxes) tree->remove(box);
+    tree->remove(moved);
+    EXPECT_EQ(tree->size(), 0);
+}
+
+// Test that point-sized items on and around the cell lines of an off-grid root reach the deepest nodes and are found
+TEST_F(LooseQuadTreeTest, ItemsOnCellLines) {
+    const Rect root(0.3f, -0.7f, 37.1f, 23.3f);
+    LooseQuadTree offGrid(root);
+    std::vector<Rect> items;
+    for (int i = -16; i <= 16; ++i) {
+        for (int j = -16; j <= 16; ++j) {
+            const float x = root.x + root.w * static_cast<float>(i) / 16.0f;
+            const float y = root.y + root.h * static_cast<float>(j) / 16.0f;
+            for (const float dx : { -1e-6f, 0.0f, 1e-6f }) {
+                const Rect item(std::nextafter(x, x + dx), std::nextafter(y, y - dx), 0.0f, 0.0f);
+                if (!root.contains(Point(item.x, item.y))) continue;
+                EXPECT_TRUE(offGrid.insert(item));
+                items.push_back(item);
+            }
+        }
+    }
+    EXPECT_EQ(offGrid.size(), static_cast<int>(items.size()));
+
+    for (const Rect &item : items) {
+        int hits = 0;
+        offGrid.queryContaining(Point(item.x, item.y), [&](const Rect &box) { hits += box == item; });
+        EXPECT_EQ(hits, 1);
+        Rect result;
+        ASSERT_TRUE(offGrid.nearest(Point(item.x, item.y), result));
+        EXPECT_EQ(distanceSquared(Point(item.x, item.y), result), 0.0f);
+    }
+    for (const Rect &item : items) {
+        EXPECT_TRUE(offGrid.remove(item));
+    }
+    EXPECT_EQ(offGrid.size(), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,44 @@
+#ifndef NEARESTHEAP_H
+#define NEARESTHEAP_H
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+// Bounded max-heap of the N closest (key, point) pairs shared by QuadTree and Orthtree, so both searches keep
+// one contract. The pairs only form a heap once N candidates were offered; fewer stay in discovery order.
+
+// Offer a candidate with key dist; maxDist tightens to the N-th key once the heap is full and never loosens
+template<size_t N, typename P>
+void offerNearest(std::vector<std::pair<float, P>> &nearestHeap, const float dist, const P &candidate, float &maxDist) {
+    // Add to heap if we haven't found N points yet
+    if (nearestHeap.size() < N) {
+        nearestHeap.emplace_back(dist, candidate);
+        if (nearestHeap.size() == N) {
+            std::ranges::make_heap(nearestHeap.begin(), nearestHeap.end()); // Build heap
+            maxDist = std::min(maxDist, nearestHeap.front().first); // A seeded maxDist may already be tighter
+        }
+    }
+    // Otherwise, only replace if the new point is closer
+    else if (dist < nearestHeap.front().first) {
+        std::ranges::pop_heap(nearestHeap.begin(), nearestHeap.end());
+        nearestHeap.back() = std::make_pair(dist, candidate);
+        std::ranges::push_heap(nearestHeap.begin(), nearestHeap.end());
+        maxDist = std::min(maxDist, nearestHeap.front().first); // Update maxDist
+    }
+}
+
+// Empty the heap into nearest, farthest first when it held N candidates, and return how many it held
+template<size_t N, typename P>
+size_t drainNearest(std::vector<std::pair<float, P>> &nearestHeap, std::array<P, N> &nearest) {
+    const size_t found = nearestHeap.size();
+    for (unsigned int i = 0; i < N && !nearestHeap.empty(); ++i) {
+        std::ranges::pop_heap(nearestHeap.begin(), nearestHeap.end());
+        nearest[i] = nearestHeap.back().second;
+        nearestHeap.pop_back();
+    }
+    return found;
+}
+
+#endif //NEARESTHEAP_H
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include "Orthtree.hpp"
+#include "QuadTree.hpp"
+
+class OctreeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create an Octree covering a 100x100x100 volume centered at (0,0,0)
+        tree = std::make_unique<Octree>(Box3({ 0.0f, 0.0f, 0.0f }, { 50.0f, 50.0f, 50.0f }));
+    }
+
+    // Fill the tree with a lattice of points and return them
+    std::vector<Point3> insertLattice() {
+        std::vector<Point3> inserted;
+        for (int i = -48; i <= 48; i += 8) {
+            for (int j = -45; j <= 45; j += 9) {
+                for (int k = -50; k <= 50; k += 10) {
+                    inserted.emplace_back(std::array<float, 3>{ static_cast<float>(i), static_cast<float>(j), static_cast<float>(k) });
+                    EXPECT_TRUE(tree->insert(inserted.back()));
+                }
+            }
+        }
+        return inserted;
+    }
+
+    std::unique_ptr<Octree> tree;
+};
+
+// Test inserting points inside and outside the Octree bounds
+TEST_F(OctreeTest, InsertPoint) {
+    EXPECT_TRUE(tree->insert(Point3({ 10.0f, 10.0f, 10.0f })));    // Point inside
+    EXPECT_TRUE(tree->insert(Point3({ 0.0f, 0.0f, 0.0f })));       // Point at the center
+    EXPECT_TRUE(tree->insert(Point3({ 50.0f, -50.0f, 50.0f })));   // Corner, edges included
+    EXPECT_FALSE(tree->insert(Point3({ 0.0f, 0.0f, 60.0f })));     // Outside along z only
+    EXPECT_EQ(tree->size(), 3);
+}
+
+// Test Octree subdivision
+TEST_F(OctreeTest, Subdivision) {
+    for (int i = 0; i < Octree::capacity(); ++i) {
+        EXPECT_TRUE(tree->insert(Point3({ static_cast<float>(i), static_cast<float>(-i), static_cast<float>(i) })));
+    }
+    EXPECT_FALSE(tree->isDivided());  // Should not be divided yet.
+
+    EXPECT_TRUE(tree->insert(Point3({ 20.0f, 20.0f, 20.0f })));
+    EXPECT_TRUE(tree->isDivided());  // Tree should now be subdivided.
+}
+
+// Test identical points are kept once the tree cannot split any further
+TEST_F(OctreeTest, IdenticalPoints) {
+    for (int i = 0; i < 40; ++i) {
+        EXPECT_TRUE(tree->insert(Point3({ 1.0f, 2.0f, 3.0f })));
+    }
+    int hits = 0;
+    tree->queryRange(Box3({ 1.0f, 2.0f, 3.0f }, { 0.0f, 0.0f, 0.0f }), [&](const Point3 &) { ++hits; });
+    EXPECT_EQ(hits, 40);
+}
+
+// Test range queries against a brute-force scan
+TEST_F(OctreeTest, QueryRange) {
+    const std::vector<Point3> inserted = insertLattice();
+    const Box3 range({ 5.0f, -10.0f, 12.0f }, { 20.0f, 14.0f, 25.0f });
+
+    std::vector<Point3> found;
+    tree->queryRange(range, [&](const Point3 &p) { found.push_back(p); });
+
+    std::vector<Point3> expected;
+    for (const Point3 &p : inserted) {
+        if (range.contains(p)) expected.push_back(p);
+    }
+    std::sort(found.begin(), found.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(found, expected);
+    EXPECT_FALSE(found.empty());
+}
+
+// Test nearest neighbors against a brute-force scan
+TEST_F(OctreeTest, NearestNeighbors) {
+    const std::vector<Point3> inserted = insertLattice();
+
+    std::array<Point3, 10> nearest;
+    float maxDist = std::numeric_limits<float>::max();
+    Octree::NodeQueue nodeQueue;
+    std::vector<std::pair<float, Point3>> nearestHeap;
+
+    for (const Point3 &target : { Point3({ 1.0f, 2.0f, 3.0f }), Point3({ 16.0f, 0.0f, -20.0f }), Point3({ -49.0f, 44.0f, 50.0f }) }) {
+        std::vector<float> distances;
+        bool skipped = false;
+        for (const Point3 &p : inserted) {
+            if (!skipped && p == target) {
+                skipped = true;
+                continue;
+            }
+            distances.push_back(distanceSquared(target, p));
+        }
+        std::sort(distances.begin(), distances.end());
+
+        nearestHeap.clear();
+        while (!nodeQueue.empty()) nodeQueue.pop();
+        tree->nearestNeighbors<10>(target, nearest, maxDist, nodeQueue, nearestHeap);
+
+        // nearest is filled from the farthest result
+        for (size_t i = 0; i < nearest.size(); ++i) {
+            EXPECT_EQ(distanceSquared(target, nearest[i]), distances[nearest.size() - 1 - i]);
+        }
+        EXPECT_EQ(maxDist, distances[nearest.size() - 1]);
+    }
+}
+
+// Test nearest neighbors on an empty tree
+TEST_F(OctreeTest, NearestNeighborsEmptyTree) {
+    std::array<Point3, 3> nearest;
+    float maxDist = 0.0f;
+    Octree::NodeQueue nodeQueue;
+    std::vector<std::pair<float, Point3>> nearestHeap;
+    tree->nearestNeighbors<3>(Point3({ 0.0f, 0.0f, 0.0f }), nearest, maxDist, nodeQueue, nearestHeap);
+    EXPECT_TRUE(nearestHeap.empty());
+}
+
+// Test points on a plane of the octree answer like the same points in a QuadTree, centre-line ties included
+TEST_F(OctreeTest, PlaneMatchesQuadTree) {
+    QuadTree quadTree(Rect(0.0f, 0.0f, 50.0f, 50.0f));
+    for (int i = 0; i < 3000; ++i) {
+        const float x = static_cast<float>((i * 37) % 101) - 50.0f;
+        const float y = static_cast<float>((i * 61) % 89) - 44.0f;
+        EXPECT_TRUE(tree->insert(Point3({ x, y, 0.0f })));
+        EXPECT_TRUE(quadTree.insert(Point(x, y)));
+    }
+
+    std::array<Point3, 8> octNearest;
+    std::array<Point, 8> quadNearest;
+    float octMax = 0.0f, quadMax = 0.0f;
+    Octree::NodeQueue octQueue;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> quadQueue;
+    std::vector<std::pair<float, Point3>> octHeap;
+    std::vector<std::pair<float, Point>> quadHeap;
+    for (const auto &[x, y] : { std::pair(3.5f, -7.25f), std::pair(0.0f, 0.0f), std::pair(-25.0f, 0.0f), std::pair(0.0f, 22.0f) }) {
+        tree->nearestNeighbors<8>(Point3({ x, y, 0.0f }), octNearest, octMax, octQueue, octHeap);
+        quadTree.nearestNeighbors<8>(Point(x, y), quadNearest, quadMax, quadQueue, quadHeap);
+        EXPECT_EQ(octMax, quadMax);
+        for (size_t i = 0; i < 8; ++i) {
+            EXPECT_EQ(distanceSquared(Point3({ x, y, 0.0f }), octNearest[i]), distanceSquared(Point(x, y), quadNearest[i]));
+        }
+    }
+
+    for (const Box3 &range : { Box3({ -10.0f, 5.0f, 0.0f }, { 17.0f, 23.0f, 1.0f }), Box3({ 0.0f, 0.0f, 0.0f }, { 25.0f, 22.0f, 0.0f }) }) {
+        int octHits = 0;
+        tree->queryRange(range, [&](const Point3 &) { ++octHits; });
+        EXPECT_EQ(octHits, quadTree.aggregate(Rect(range.centre[0], range.centre[1], range.half[0], range.half[1])).count);
+    }
+}
+
+// Test the 2D instance answers exactly like QuadTree over an off-grid root, with points on its centre lines
+TEST_F(OctreeTest, QuadtreeInstanceMatchesQuadTree) {
+    const Rect root(0.3f, -0.7f, 37.1f, 23.3f);
+    Orthtree<2> orthtree(Box<2>(root.centre(), root.half()));
+    QuadTree quadTree(root);
+    for (int i = 0; i < 3000; ++i) {
+        // Every seventh point sits on a line through the root's centre
+        const float x = i % 7 == 0 ? root.x : root.x + root.w * static_cast<float>((i * 37) % 101 - 50) / 50.0f;
+        const float y = i % 7 == 3 ? root.y : root.y + root.h * static_cast<float>((i * 61) % 89 - 44) / 44.0f;
+        EXPECT_TRUE(orthtree.insert(PointN<2>({ x, y }, static_cast<float>(i))));
+        EXPECT_TRUE(quadTree.insert(Point(x, y, static_cast<float>(i))));
+    }
+    EXPECT_EQ(orthtree.size(), quadTree.aggregate(root).count);
+
+    std::array<PointN<2>, 8> orthNearest;
+    std::array<Point, 8> quadNearest;
+    float orthMax = 0.0f, quadMax = 0.0f;
+    Orthtree<2>::NodeQueue orthQueue;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> quadQueue;
+    std::vector<std::pair<float, PointN<2>>> orthHeap;
+    std::vector<std::pair<float, Point>> quadHeap;
+    for (const Point &target : { Point(3.5f, -7.25f), Point(root.x, root.y), Point(root.x, 10.0f), Point(-30.0f, root.y) }) {
+        orthHeap.clear();
+        quadHeap.clear();
+        orthtree.nearestNeighbors<8>(PointN<2>(target.coords()), orthNearest, orthMax, orthQueue, orthHeap);
+        quadTree.nearestNeighbors<8>(target, quadNearest, quadMax, quadQueue, quadHeap);
+        EXPECT_EQ(orthMax, quadMax);
+        for (size_t i = 0; i < 8; ++i) {
+            EXPECT_EQ(distanceSquared(PointN<2>(target.coords()), orthNearest[i]), distanceSquared(target, quadNearest[i]));
+        }
+    }
+
+    for (const Rect &range : { Rect(-10.0f, 5.0f, 17.0f, 13.0f), Rect(root.x, root.y, 9.0f, 0.0f), Rect(root.x, 2.0f, 0.0f, 30.0f) }) {
+        std::vector<Point> orthFound, quadFound;
+        orthtree.queryRange(Box<2>(range.centre(), range.half()), [&](const PointN<2> &p) { orthFound.emplace_back(p.coords[0], p.coords[1]); });
+        quadTree.queryRange(range, [&](const Point &p) { quadFound.emplace_back(p.x, p.y); });
+        std::sort(orthFound.begin(), orthFound.end());
+        std::sort(quadFound.begin(), quadFound.end());
+        EXPECT_EQ(orthFound, quadFound);
+        EXPECT_FALSE(orthFound.empty());
+    }
+}
+
+// Test fewer than N neighbours come out in the same order as from QuadTree
+TEST_F(OctreeTest, NearestNeighborsFewerPointsMatchQuadTree) {
+    QuadTree quadTree(Rect(0.0f, 0.0f, 50.0f, 50.0f));
+    for (const auto &[x, y] : { std::pair(10.0f, 10.0f), std::pair(-10.0f, -10.0f), std::pair(20.0f, 20.0f), std::pair(-20.0f, -20.0f) }) {
+        EXPECT_TRUE(tree->insert(Point3({ x, y, 0.0f })));
+        EXPECT_TRUE(quadTree.insert(Point(x, y)));
+    }
+
+    std::array<Point3, 8> octNearest;
+    std::array<Point, 8> quadNearest;
+    float octMax = 0.0f, quadMax = 0.0f;
+    Octree::NodeQueue octQueue;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> quadQueue;
+    std::vector<std::pair<float, Point3>> octHeap;
+    std::vector<std::pair<float, Point>> quadHeap;
+    tree->nearestNeighbors<8>(Point3({ 0.0f, 0.0f, 0.0f }), octNearest, octMax, octQueue, octHeap);
+    quadTree.nearestNeighbors<8>(Point(0.0f, 0.0f), quadNearest, quadMax, quadQueue, quadHeap);
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(octNearest[i].coords[0], quadNearest[i].x);
+        EXPECT_EQ(octNearest[i].coords[1], quadNearest[i].y);
+    }
+}
+
+// Test children of a root with inexact halves still hold the points routed to them
+TEST_F(OctreeTest, ChildBoundariesHoldRoutedPoints) {
+    Octree skewed(Box3({ -0.517687976f, 0.920465469f, 1.72283113f }, { 38.4214096f, 43.0454597f, 10.1294842f }));
+    const std::vector<Point3> points = {
+        Point3({ 3.92695856f, 19.3065414f, -1.08172452f }), Point3({ -37.1626778f, -22.7498436f, -2.0095346f }),
+        Point3({ -7.70096159f, 6.32440042f, 1.09359241f }), Point3({ 18.5514278f, -18.9462528f, 3.94369316f }),
+        Point3({ -16.5169182f, 0.92046541f, 0.865600765f }), Point3({ 6.11022949f, 32.8664017f, 1.72283125f }),
+        Point3({ -0.517688036f, -35.6509476f, -4.24525166f }), Point3({ 0.560803771f, 0.920465469f, -6.6394763f }),
+        Point3({ -1.77902246f, -3.73701358f, 1.72283113f }), Point3({ -0.517687976f, 2.30606842f, 6.72165489f }),
+        Point3({ 14.1664295f, 0.920465469f, 5.55543137f }), Point3({ -10.2306118f, 30.5174122f, 1.72283125f }) };
+    for (const Point3 &p : points) ASSERT_TRUE(skewed.insert(p));
+    ASSERT_TRUE(skewed.isDivided());
+
+    for (const Point3 &p : points) {
+        int hits = 0;
+        skewed.queryRange(Box3(p.coords, { 0.0f, 0.0f, 0.0f }), [&](const Point3 &) { ++hits; });
+        EXPECT_EQ(hits, 1);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
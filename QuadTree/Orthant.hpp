@@ -0,0 +1,106 @@
+#ifndef ORTHANT_H
+#define ORTHANT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+// Geometry over D coordinates shared by QuadTree and Orthtree: boxes given by centre and half extents with
+// their edges included, which child of a box a point is routed to, the boundary of that child, and distances.
+// QuadTree's Point and Rect are the D = 2 instance with named fields; Orthtree works on the arrays directly.
+template<int D>
+using Coords = std::array<float, D>;
+
+// Child of a box with the given centre holding p. Bit 0 is set when p lies below the centre along axis 0 and
+// bit d when it lies above it along axis d > 0, so a tie goes up along axis 0 and down along the others.
+// In 2D the children come out as QuadTree's NE, NW, SE, SW.
+template<int D>
+int orthantOf(const Coords<D> &centre, const Coords<D> &p) {
+    int index = p[0] < centre[0];
+    for (int d = 1; d < D; ++d) {
+        index |= (p[d] > centre[d]) << d;
+    }
+    return index;
+}
+
+// True if child orthant lies in the upper half of its parent along axis d
+inline bool orthantUpper(const int orthant, const int d) {
+    return (((orthant >> d) & 1) != 0) != (d == 0);
+}
+
+// Centre and half extent of [low, high], the half extent widened until both ends are inside despite rounding.
+// A half extent far below the ulp of the centre needs many of its own ulps to move an end, so each step doubles.
+inline void spanBetween(const float low, const float high, float &centre, float &half) {
+    centre = (low + high) / 2;
+    half = (high - low) / 2;
+    float step = std::nextafter(half, std::numeric_limits<float>::max()) - half;
+    while (low < centre - half || high > centre + half) {
+        half += step;
+        step *= 2;
+    }
+}
+
+// Boundary of one child of the box (centre, half), spanned between the parent's edges and its centre planes,
+// which orthantOf compares against, so every point routed to the child is inside it
+template<int D>
+void orthantBounds(const Coords<D> &centre, const Coords<D> &half, const int orthant, Coords<D> &childCentre, Coords<D> &childHalf) {
+    for (int d = 0; d < D; ++d) {
+        const bool upper = orthantUpper(orthant, d);
+        const float low = upper ? centre[d] : centre[d] - half[d];
+        const float high = upper ? centre[d] + half[d] : centre[d];
+        spanBetween(low, high, childCentre[d], childHalf[d]);
+    }
+}
+
+// True if p lies inside the box (centre, half), edges included
+template<int D>
+bool boxContains(const Coords<D> &centre, const Coords<D> &half, const Coords<D> &p) {
+    bool inside = true;
+    for (int d = 0; d < D; ++d) {
+        inside &= p[d] >= centre[d] - half[d] && p[d] <= centre[d] + half[d];
+    }
+    return inside;
+}
+
+// True if the boxes overlap, touching edges included
+template<int D>
+bool boxesIntersect(const Coords<D> &centre, const Coords<D> &half, const Coords<D> &otherCentre, const Coords<D> &otherHalf) {
+    for (int d = 0; d < D; ++d) {
+        if (otherCentre[d] - otherHalf[d] > centre[d] + half[d] || otherCentre[d] + otherHalf[d] < centre[d] - half[d]) return false;
+    }
+    return true;
+}
+
+// True if the other box lies entirely within the box (centre, half), edges included
+template<int D>
+bool boxContainsBox(const Coords<D> &centre, const Coords<D> &half, const Coords<D> &otherCentre, const Coords<D> &otherHalf) {
+    for (int d = 0; d < D; ++d) {
+        if (otherCentre[d] - otherHalf[d] < centre[d] - half[d] || otherCentre[d] + otherHalf[d] > centre[d] + half[d]) return false;
+    }
+    return true;
+}
+
+// Squared Euclidean distance between two points
+template<int D>
+float distanceSquared(const Coords<D> &a, const Coords<D> &b) {
+    float sum = 0.0f;
+    for (int d = 0; d < D; ++d) {
+        const float delta = a[d] - b[d];
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+// Squared distance from p to the closest point of the box (centre, half), zero when it lies inside
+template<int D>
+float distanceSquared(const Coords<D> &p, const Coords<D> &centre, const Coords<D> &half) {
+    float sum = 0.0f;
+    for (int d = 0; d < D; ++d) {
+        const float delta = std::max(0.0f, std::abs(p[d] - centre[d]) - half[d]);
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+#endif //ORTHANT_H
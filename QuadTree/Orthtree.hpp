@@ -0,0 +1,126 @@
+#ifndef ORTHTREE_H
+#define ORTHTREE_H
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include "NearestHeap.hpp"
+#include "Orthant.hpp"
+
+// Point in D dimensions with a payload
+template<int D>
+struct PointN {
+    Coords<D> coords{};
+    float payload = 0.0f;
+
+    PointN() = default;
+    explicit PointN(const Coords<D> &coords, const float payload = 0.0f) : coords(coords), payload(payload) {}
+
+    bool operator==(const PointN &other) const { return coords == other.coords; } // Equal by coordinates
+    bool operator<(const PointN &other) const { return coords < other.coords; } // Lexicographic by coordinates
+};
+
+// Axis-aligned box in D dimensions given by its centre and half extents, edges included
+template<int D>
+struct Box {
+    Coords<D> centre{};
+    Coords<D> half{};
+
+    Box() = default;
+    Box(const Coords<D> &centre, const Coords<D> &half) : centre(centre), half(half) {}
+
+    [[nodiscard]] bool contains(const PointN<D> &p) const;
+    [[nodiscard]] bool intersects(const Box &other) const;
+    [[nodiscard]] bool contains(const Box &other) const;
+    bool operator==(const Box &other) const { return centre == other.centre && half == other.half; }
+};
+
+template<int D>
+float distanceSquared(const PointN<D> &a, const PointN<D> &b); // Squared distance between two points
+
+template<int D>
+float distanceSquared(const PointN<D> &p, const Box<D> &box); // Squared distance to the closest point of a box, zero inside
+
+// Point tree with 2^D children per node, such as an octree over altitude data. Its geometry (Orthant.hpp) and
+// KNN heap (NearestHeap.hpp) are the ones QuadTree is built on, so Orthtree<2> routes points, spans children
+// and orders results exactly as QuadTree does. QuadTree remains the tuned 2D tree, adding metric policies,
+// prefetching, page-allocated storage, timestamps and leaf handles on top of insert, range queries and KNN.
+template<int D>
+class Orthtree {
+    static_assert(D >= 1 && D <= 8, "a node has 2^D children");
+
+public:
+    static constexpr int CHILDREN = 1 << D; // Children of a divided node
+    static constexpr int CAPACITY = CHILDREN; // Max number of points before subdividing the node, one per child as in QuadTree
+
+private:
+    static constexpr int MAX_DEPTH = 24; // Beyond this many halvings a float boundary can no longer separate points
+
+    struct Node {
+        Box<D> boundary; // The box this node represents
+        std::array<PointN<D>, CAPACITY> points; // Points stored in a leaf
+        int point_count = 0; // Current number of points in the node
+        int firstChild = -1; // Arena index of the first of the 2^D consecutive children, -1 for a leaf
+        int overflow = -1; // Index into overflowPoints for a leaf that reached MAX_DEPTH, -1 if none
+        int depth = 0; // Depth below the root, bounds further subdivision
+        int subtreeCount = 0; // Number of points stored in this subtree
+
+        Node() = default;
+        explicit Node(const Box<D> &boundary, const int depth = 0) : boundary(boundary), depth(depth) {}
+
+        [[nodiscard]] bool divided() const { return firstChild >= 0; }
+    };
+
+    std::vector<Node> nodes; // Node arena; the root is nodes[0] and siblings are always adjacent
+    std::vector<std::vector<PointN<D>>> overflowPoints; // Points beyond CAPACITY in leaves that reached MAX_DEPTH
+
+    // Child of boundary holding p, numbered by orthantOf like QuadTree::quadrantOf
+    static int childIndex(const Box<D> &boundary, const PointN<D> &p);
+    static Box<D> childBox(const Box<D> &parent, int child); // Boundary of one child, spanned from parent's edges and centre
+
+    void subdivide(int index); // Append the 2^D children of nodes[index] and move its points into them
+    void insertFrom(int index, const PointN<D> &point); // Iterative descent from nodes[index], which contains point
+
+    template<typename Visitor>
+    void queryRange_rec(const Node &node, const Box<D> &range, Visitor &visitor) const;
+
+public:
+    // Entry of the KNN node queue; a preallocated queue can be reused across queries like QuadTree's
+    struct QueueEntry {
+        const Node *node;
+        float distance;
+
+        bool operator>(const QueueEntry &other) const { return distance > other.distance; }
+    };
+    using NodeQueue = std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>>;
+
+    explicit Orthtree(const Box<D> &boundary); // Constructor initializing the tree with a root boundary
+
+    [[nodiscard]] const Box<D> &getBoundary() const; // The boundary covered by the root
+    [[nodiscard]] bool isDivided() const; // Check if the root is subdivided
+    [[nodiscard]] int size() const; // Number of stored points
+    static int capacity();
+
+    bool insert(const PointN<D> &point); // Insert a point; false if it is outside the root
+
+    // Visit every point inside range (edges included)
+    template<typename Visitor>
+    void queryRange(const Box<D> &range, Visitor &&visitor) const;
+
+    // Nearest neighbor search with preallocated memory and the same contract as QuadTree::nearestNeighbors:
+    // the target itself is skipped once, and nearest is filled from the farthest of the N results
+    template<size_t N>
+    void nearestNeighbors(const PointN<D> &target, std::array<PointN<D>, N> &nearest, float &maxDist,
+                          NodeQueue &nodeQueue, std::vector<std::pair<float, PointN<D>>> &nearestHeap) const;
+};
+
+using Point3 = PointN<3>;
+using Box3 = Box<3>;
+using Octree = Orthtree<3>;
+
+#include "Orthtree.tpp"
+
+#endif //ORTHTREE_H
@@ -0,0 +1,200 @@
+#ifndef ORTHTREE_TPP
+#define ORTHTREE_TPP
+
+#include <algorithm>
+#include <limits>
+
+template<int D>
+bool Box<D>::contains(const PointN<D> &p) const {
+    return boxContains<D>(centre, half, p.coords);
+}
+
+template<int D>
+bool Box<D>::intersects(const Box &other) const {
+    return boxesIntersect<D>(centre, half, other.centre, other.half);
+}
+
+template<int D>
+bool Box<D>::contains(const Box &other) const {
+    return boxContainsBox<D>(centre, half, other.centre, other.half);
+}
+
+template<int D>
+float distanceSquared(const PointN<D> &a, const PointN<D> &b) {
+    return distanceSquared<D>(a.coords, b.coords);
+}
+
+template<int D>
+float distanceSquared(const PointN<D> &p, const Box<D> &box) {
+    return distanceSquared<D>(p.coords, box.centre, box.half);
+}
+
+// Constructor for the Orthtree, initializes with a boundary box
+template<int D>
+Orthtree<D>::Orthtree(const Box<D> &boundary) : nodes{Node(boundary)} {}
+
+template<int D>
+const Box<D> &Orthtree<D>::getBoundary() const {
+    return nodes[0].boundary;
+}
+
+template<int D>
+bool Orthtree<D>::isDivided() const {
+    return nodes[0].divided();
+}
+
+template<int D>
+int Orthtree<D>::size() const {
+    return nodes[0].subtreeCount;
+}
+
+template<int D>
+int Orthtree<D>::capacity() {
+    return CAPACITY;
+}
+
+template<int D>
+int Orthtree<D>::childIndex(const Box<D> &boundary, const PointN<D> &p) {
+    return orthantOf<D>(boundary.centre, p.coords);
+}
+
+template<int D>
+Box<D> Orthtree<D>::childBox(const Box<D> &parent, const int child) {
+    Box<D> box;
+    orthantBounds<D>(parent.centre, parent.half, child, box.centre, box.half);
+    return box;
+}
+
+// Subdivides nodes[index] into 2^D child nodes appended to the arena as one sibling group
+template<int D>
+void Orthtree<D>::subdivide(const int index) {
+    const int first = static_cast<int>(nodes.size());
+    const Box<D> boundary = nodes[index].boundary;
+    const int depth = nodes[index].depth;
+    for (int c = 0; c < CHILDREN; ++c) {
+        nodes.emplace_back(childBox(boundary, c), depth + 1); // May reallocate the arena, hence the copies above
+    }
+
+    Node &node = nodes[index];
+    node.firstChild = first;
+    const std::array<PointN<D>, CAPACITY> moved = node.points;
+    const int count = node.point_count;
+    node.point_count = 0;
+
+    for (int i = 0; i < count; ++i) {
+        insertFrom(first + childIndex(boundary, moved[i]), moved[i]);
+    }
+}
+
+template<int D>
+bool Orthtree<D>::insert(const PointN<D> &point) {
+    if (!nodes[0].boundary.contains(point)) {
+        return false; // Point is outside the root boundary
+    }
+    insertFrom(0, point);
+    return true;
+}
+
+template<int D>
+void Orthtree<D>::insertFrom(int index, const PointN<D> &point) {
+    while (true) {
+        Node &node = nodes[index];
+        ++node.subtreeCount;
+
+        if (node.point_count < CAPACITY && !node.divided()) {
+            node.points[node.point_count] = point;
+            node.point_count++;
+            return;
+        }
+
+        if (!node.divided() && node.depth >= MAX_DEPTH) {
+            // Too deep to split any further, keep the point in this leaf
+            if (node.overflow < 0) {
+                node.overflow = static_cast<int>(overflowPoints.size());
+                overflowPoints.emplace_back();
+            }
+            overflowPoints[node.overflow].push_back(point);
+            return;
+        }
+
+        if (!node.divided()) {
+            subdivide(index); // Invalidates node
+        }
+        index = nodes[index].firstChild + childIndex(nodes[index].boundary, point);
+    }
+}
+
+template<int D>
+template<typename Visitor>
+void Orthtree<D>::queryRange(const Box<D> &range, Visitor &&visitor) const {
+    queryRange_rec(nodes[0], range, visitor);
+}
+
+template<int D>
+template<typename Visitor>
+void Orthtree<D>::queryRange_rec(const Node &node, const Box<D> &range, Visitor &visitor) const {
+    if (node.subtreeCount == 0 || !node.boundary.intersects(range)) return;
+
+    for (int i = 0; i < node.point_count; ++i) {
+        if (range.contains(node.points[i])) visitor(node.points[i]);
+    }
+    if (node.overflow >= 0) {
+        for (const PointN<D> &p : overflowPoints[node.overflow]) {
+            if (range.contains(p)) visitor(p);
+        }
+    }
+    if (node.divided()) {
+        for (int c = 0; c < CHILDREN; ++c) queryRange_rec(nodes[node.firstChild + c], range, visitor);
+    }
+}
+
+// Best-first search over nodes ordered by their distance to the target, as in QuadTree
+template<int D>
+template<size_t N>
+void Orthtree<D>::nearestNeighbors(const PointN<D> &target, std::array<PointN<D>, N> &nearest, float &maxDist,
+                                   NodeQueue &nodeQueue, std::vector<std::pair<float, PointN<D>>> &nearestHeap) const {
+    maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false; // The query point itself is skipped once if it is stored in the tree
+
+    auto consider = [&](const PointN<D> &candidate) {
+        if (!targetSkipped && candidate == target) {
+            targetSkipped = true;
+            return;
+        }
+        offerNearest<N>(nearestHeap, distanceSquared(target, candidate), candidate, maxDist);
+    };
+
+    if (nodes[0].subtreeCount > 0) {
+        nodeQueue.push(QueueEntry{&nodes[0], 0.0f});
+    }
+    while (!nodeQueue.empty()) {
+        const Node *current = nodeQueue.top().node;
+        const float currentDistance = nodeQueue.top().distance;
+        nodeQueue.pop();
+
+        // Stop if the closest node left is farther than the farthest neighbour found
+        if (currentDistance > maxDist) break;
+
+        for (int i = 0; i < current->point_count; ++i) {
+            consider(current->points[i]);
+        }
+        if (current->overflow >= 0) {
+            for (const PointN<D> &candidate : overflowPoints[current->overflow]) consider(candidate);
+        }
+
+        if (current->divided()) {
+            for (int c = 0; c < CHILDREN; ++c) {
+                const Node *child = &nodes[current->firstChild + c];
+                if (child->subtreeCount == 0) continue;
+                const float minDist = distanceSquared(target, child->boundary);
+                if (minDist <= maxDist) {
+                    nodeQueue.push(QueueEntry{child, minDist});
+                }
+            }
+        }
+    }
+
+    drainNearest(nearestHeap, nearest); // Populate the nearest array
+}
+
+#endif // ORTHTREE_TPP
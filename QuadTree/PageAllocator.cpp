@@ -0,0 +1,60 @@
+#include "PageAllocator.hpp"
+
+#include <cstdint>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26) // log2(2MB) in the MAP_HUGE_SHIFT bits
+#endif
+
+static size_t roundToHugePages(const size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+bool usesPageMapping(const size_t bytes, const MemoryPolicy &policy) {
+    const bool mapped = policy.pages != MemoryPolicy::Pages::Default || policy.interleave;
+    return mapped && bytes >= HUGE_PAGE_SIZE / 2;
+}
+
+// Interleaves a fresh mapping over the allowed NUMA nodes. Pages are placed when first touched, so the
+// policy only has to be set before the arena writes to them. Without NUMA support this quietly does nothing.
+static void interleave(void *address, const size_t bytes) {
+    unsigned long allowed[16] = {};
+    const unsigned long maxNode = sizeof(allowed) * 8;
+    int mode = 0;
+    if (syscall(SYS_get_mempolicy, &mode, allowed, maxNode, nullptr, MPOL_F_MEMS_ALLOWED) != 0) return;
+    syscall(SYS_mbind, address, bytes, MPOL_INTERLEAVE, allowed, maxNode, 0);
+}
+
+void *mapPages(const size_t bytes, const MemoryPolicy &policy) {
+    const size_t length = roundToHugePages(bytes);
+    void *address = nullptr;
+
+    if (policy.pages == MemoryPolicy::Pages::HugeTLB) {
+        address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (address == MAP_FAILED) address = nullptr; // The reserved pool is empty or absent
+    }
+    if (!address) {
+        // Over-map by one huge page and trim both ends, so the kernel can back the range with whole 2MB pages
+        void *raw = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+        const uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        if (aligned > start) munmap(raw, aligned - start);
+        if (aligned + length < start + length + HUGE_PAGE_SIZE) {
+            munmap(reinterpret_cast<void *>(aligned + length), start + HUGE_PAGE_SIZE - aligned);
+        }
+        address = reinterpret_cast<void *>(aligned);
+        if (policy.pages != MemoryPolicy::Pages::Default) madvise(address, length, MADV_HUGEPAGE);
+    }
+
+    if (policy.interleave) interleave(address, length);
+    return address;
+}
+
+void unmapPages(void *address, const size_t bytes) {
+    munmap(address, roundToHugePages(bytes));
+}
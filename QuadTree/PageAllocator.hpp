@@ -0,0 +1,68 @@
+#ifndef PAGEALLOCATOR_H
+#define PAGEALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+// How the memory of large arenas is backed. A tree of many millions of points spans gigabytes of nodes,
+// and with 4KB pages most KNN steps miss the TLB; 2MB pages cover the same nodes with 512x fewer entries.
+struct MemoryPolicy {
+    enum class Pages : uint8_t {
+        Default, // Ordinary heap memory
+        Transparent, // 2MB-aligned mappings advised with MADV_HUGEPAGE, promoted by the kernel when it can
+        HugeTLB, // Explicit hugetlbfs pages from the reserved pool, falling back to Transparent when it is empty
+    };
+
+    Pages pages = Pages::Default;
+    bool interleave = false; // Spread the pages round-robin over the NUMA nodes the process may use
+
+    bool operator==(const MemoryPolicy &other) const = default;
+};
+
+inline constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20;
+
+// Allocations this large or larger follow the policy; smaller ones stay on the heap, where a 2MB mapping would waste memory
+[[nodiscard]] bool usesPageMapping(size_t bytes, const MemoryPolicy &policy);
+
+void *mapPages(size_t bytes, const MemoryPolicy &policy); // 2MB-aligned mapping of bytes rounded up to 2MB, null on failure
+void unmapPages(void *address, size_t bytes); // Release a mapping from mapPages with the same byte count
+
+// Standard allocator applying a MemoryPolicy, for std::vector arenas such as QuadTree's nodes. The policy is
+// part of the allocator's state, so it moves along with the container's memory.
+template<typename T>
+class PageAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    MemoryPolicy policy;
+
+    PageAllocator() = default;
+    explicit PageAllocator(const MemoryPolicy &policy) : policy(policy) {}
+    template<typename U>
+    PageAllocator(const PageAllocator<U> &other) : policy(other.policy) {}
+
+    T *allocate(const size_t n) {
+        const size_t bytes = n * sizeof(T);
+        if (!usesPageMapping(bytes, policy)) return static_cast<T *>(::operator new(bytes));
+        void *address = mapPages(bytes, policy);
+        if (!address) std::abort(); // Out of memory, as operator new would be without exceptions
+        return static_cast<T *>(address);
+    }
+
+    void deallocate(T *address, const size_t n) {
+        const size_t bytes = n * sizeof(T);
+        if (usesPageMapping(bytes, policy)) unmapPages(address, bytes);
+        else ::operator delete(address);
+    }
+
+    template<typename U>
+    bool operator==(const PageAllocator<U> &other) const { return policy == other.policy; }
+};
+
+#endif //PAGEALLOCATOR_H
@@ -1,6 +1,10 @@
 #include "QuadTree.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <thread>
 
 // Checks if two points are equal based on their coordinates
 bool Point::operator==(const Point &other) const {
@@ -19,80 +23,1015 @@ bool Point::operator!=(const Point &other) const {
 
 // This method includes points on the right and bottom edges when determining if a point is within the rectangle
 bool Rect::contains(const Point &p) const {
-    return p.x >= x - w && p.x <= x + w && p.y >= y - h && p.y <= y + h;
-
+    return boxContains<2>(centre(), half(), p.coords());
 }
 
 // Checks whether two rectangles overlap by comparing their boundaries
 bool Rect::intersects(const Rect &range) const {
-    return !(range.x - range.w > x + w || range.x + range.w < x - w ||
-             range.y - range.h > y + h || range.y + range.h < y - h);
+    return boxesIntersect<2>(centre(), half(), range.centre(), range.half());
+}
+
+// Checks whether another rectangle lies entirely within this one, edges included
+bool Rect::contains(const Rect &other) const {
+    return boxContainsBox<2>(centre(), half(), other.centre(), other.half());
+}
+
+// The half extents are widened where rounding would leave an edge outside, so rectangles built from shared
+// grid lines share their edges and the outer ones reach the lines they were given
+Rect rectBetween(const float left, const float right, const float top, const float bottom) {
+    Rect rect;
+    spanBetween(left, right, rect.x, rect.w);
+    spanBetween(top, bottom, rect.y, rect.h);
+    return rect;
+}
+
+bool Rect::operator==(const Rect &other) const {
+    return x == other.x && y == other.y && w == other.w && h == other.h;
+}
+
+void PayloadAggregate::add(const Point &p) {
+    ++count;
+    sum += static_cast<double>(p.payload);
+    min = std::min(min, p.payload);
+    max = std::max(max, p.payload);
+}
+
+void PayloadAggregate::merge(const PayloadAggregate &other) {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+// The box spans longitudes r.x +- r.w and latitudes r.y +- r.h; longitudes are compared modulo 360
+float HaversineMetric::lowerBound(const Point &p, const Rect &r) {
+    const float south = std::max(r.y - r.h, -90.0f);
+    const float north = std::min(r.y + r.h, 90.0f);
+    const float width = 2 * r.w;
+
+    // How far east of the box's western edge p lies, folded into [0, 360)
+    float offset = std::fmod(p.x - (r.x - r.w), 360.0f);
+    if (offset < 0.0f) offset += 360.0f;
+
+    if (width >= 360.0f || offset <= width) {
+        // Within the box's longitudes the nearest point lies straight north or south along p's meridian
+        const float dLat = p.y < south ? south - p.y : (p.y > north ? p.y - north : 0.0f);
+        const float sinHalf = std::sin(dLat * RADIANS / 2);
+        return sinHalf * sinHalf;
+    }
+
+    // Otherwise it lies on the nearer edge meridian, dLon degrees away going around whichever side is shorter
+    const float dLon = std::min(offset - width, 360.0f - offset);
+    if (dLon < 90.0f) {
+        // Foot of the perpendicular from p onto that meridian's great circle
+        const float footLat = std::atan(std::tan(p.y * RADIANS) / std::cos(dLon * RADIANS)) / RADIANS;
+        if (footLat >= south && footLat <= north) {
+            // sin of the cross-track angle, turned into sin^2(d / 2) without cancellation for short distances
+            const float sinCross = std::cos(p.y * RADIANS) * std::sin(dLon * RADIANS);
+            const float sinCross2 = sinCross * sinCross;
+            return sinCross2 / (2 * (1 + std::sqrt(std::max(0.0f, 1 - sinCross2))));
+        }
+    }
+    // The distance along the meridian segment is smallest at one of its ends
+    return std::min(key(p, Point(p.x + dLon, south)), key(p, Point(p.x + dLon, north)));
 }
 
 // Constructor for the QuadTree, initializes with a boundary rectangle
-QuadTree::QuadTree(const Rect &boundary) : boundary(boundary) {}
+QuadTree::QuadTree(const Rect &boundary) : nodes{Node(boundary)} {}
+
+QuadTree::QuadTree(const Rect &boundary, const bool growable) : nodes{Node(boundary)}, growable(growable) {}
+
+const Rect &QuadTree::getBoundary() const {
+    return nodes[0].boundary;
+}
+
+std::span<const Point> QuadTree::overflowOf(const Node &node) const {
+    if (node.overflow < 0) return {};
+    return overflowPoints[node.overflow];
+}
+
+// Child boundaries follow the quadrant order: east children sit right of the centre, north children above it.
+// orthantBounds spans them between the parent's edges and its centre lines, which quadrantOf compares against,
+// so every point quadrantOf routes to a child is inside it; centre plus or minus half the extent can round past them.
+Rect QuadTree::quadrantRect(const Rect &parent, const int quadrant) {
+    Coords<2> centre, half;
+    orthantBounds<2>(parent.centre(), parent.half(), quadrant, centre, half);
+    return Rect(centre[0], centre[1], half[0], half[1]);
+}
+
+// Rectangle holding r whose centre and half extents are multiples of a power of two at least as large as r, per
+// axis. Doubling it and taking the quadrant back with quadrantRect are then exact, so it grows without rounding.
+static Rect dyadicCover(const Rect &r) {
+    auto cover = [](const float centre, const float half, float &snappedCentre, float &snappedHalf) {
+        int exponent;
+        std::frexp(2 * half, &exponent);
+        const float step = std::ldexp(1.0f, exponent - 1); // Half of the power of two spanning the rectangle
+        snappedCentre = std::round(centre / step) * step; // Moves the centre by at most step / 2
+        snappedHalf = 2 * step; // Still reaches both edges after the move
+    };
+    Rect snapped;
+    cover(r.x, r.w, snapped.x, snapped.w);
+    cover(r.y, r.h, snapped.y, snapped.h);
+    return snapped;
+}
+
+// Extends east unless the point lies west of the root, and south unless it lies north
+Rect QuadTree::grownBoundary(const Rect &boundary, const Point &point, int &quadrant) {
+    const bool east = point.x >= boundary.x - boundary.w;
+    const bool south = point.y >= boundary.y - boundary.h;
+    const Rect grown(boundary.x + (east ? boundary.w : -boundary.w), boundary.y + (south ? boundary.h : -boundary.h),
+                     boundary.w * 2, boundary.h * 2);
+    quadrant = east ? (south ? NORTHWEST : SOUTHWEST) : (south ? NORTHEAST : SOUTHEAST);
+
+    // The old root only stands in for a quadrant of the grown one if it is exactly that quadrant; otherwise
+    // points routed to it could fall outside its edges. A root off the power-of-two grid is rebuilt onto it once.
+    if (!(quadrantRect(grown, quadrant) == boundary)) {
+        quadrant = -1;
+        return dyadicCover(grown);
+    }
+    return grown;
+}
 
-// Subdivides the current QuadTree node into four child nodes
-void QuadTree::subdivide() {
-    if (point_count == 0) return; // No points to subdivide if none exist
+// Doubles the root so the old root becomes the quadrant facing away from point; nothing is reinserted
+bool QuadTree::growToward(const Point &point) {
+    const Rect boundary = nodes[0].boundary;
+    if (boundary.w <= 0.0f || boundary.h <= 0.0f) return false; // A degenerate root cannot grow
 
-    // Calculate the midpoints to divide the boundary into quadrants
-    const float midX = boundary.x;
-    const float midY = boundary.y;
+    int quadrant;
+    const Rect grown = grownBoundary(boundary, point, quadrant);
+    if (quadrant < 0) {
+        rebuild(grown);
+        return true;
+    }
 
-    const float halfWidth = boundary.w / 2;
-    const float halfHeight = boundary.h / 2;
+    // Append a sibling group for the new root; the old root is copied into the quadrant opposite the growth
+    const int first = static_cast<int>(nodes.size());
+    for (int q = 0; q < 4; ++q) {
+        nodes.emplace_back(quadrantRect(grown, q), 1);
+        nodes.back().parent = 0;
+    }
+    const int slot = first + quadrant;
+    nodes[slot] = nodes[0]; // Its children keep their arena indices, so the subtree moves in O(1)
+    nodes[slot].parent = 0;
+    if (nodes[slot].divided()) {
+        for (int q = 0; q < 4; ++q) nodes[nodes[slot].firstChild + q].parent = slot;
+    }
+    if (timed) {
+        stamps.resize(nodes.size());
+        stamps[slot] = stamps[0];
+        stamps[0] = Stamps();
+        stamps[0].oldest = stamps[slot].oldest;
+    }
 
-    // Creates smaller boundary rectangles for each quadrant and initializes child QuadTrees
-    northeast = std::make_unique<QuadTree>(Rect(midX + halfWidth, midY - halfHeight, halfWidth, halfHeight));
-    northwest = std::make_unique<QuadTree>(Rect(midX - halfWidth, midY - halfHeight, halfWidth, halfHeight));
-    southeast = std::make_unique<QuadTree>(Rect(midX + halfWidth, midY + halfHeight, halfWidth, halfHeight));
-    southwest = std::make_unique<QuadTree>(Rect(midX - halfWidth, midY + halfHeight, halfWidth, halfHeight));
+    Node &root = nodes[0];
+    root = Node(grown);
+    root.firstChild = first;
+    root.subtreeCount = nodes[slot].subtreeCount;
+    root.payloadSum = nodes[slot].payloadSum;
+    root.payloadMin = nodes[slot].payloadMin;
+    root.payloadMax = nodes[slot].payloadMax;
+    return true;
+}
 
-    // Redistribute points from the parent node into child nodes
-    for (int i = 0; i < point_count; ++i) {
-        if (!northeast->insert(points[i]) &&
-            !northwest->insert(points[i]) &&
-            !southeast->insert(points[i])) {
-            southwest->insert(points[i]);
+// Collects every point with its stamp, then inserts them again below an empty root
+void QuadTree::rebuild(const Rect &boundary) {
+    std::vector<std::pair<Point, double>> points;
+    points.reserve(static_cast<size_t>(nodes[0].subtreeCount));
+    std::vector<int> pending = {0};
+    while (!pending.empty()) {
+        const int index = pending.back();
+        pending.pop_back();
+        const Node &node = nodes[index];
+        for (int i = 0; i < node.point_count; ++i) points.emplace_back(node.points[i], timed ? stamps[index].points[i] : NEVER);
+        if (node.overflow >= 0) {
+            for (size_t i = 0; i < overflowPoints[node.overflow].size(); ++i) {
+                points.emplace_back(overflowPoints[node.overflow][i], timed ? overflowStamps[node.overflow][i] : NEVER);
+            }
+        }
+        if (node.divided()) {
+            for (int q = 0; q < 4; ++q) pending.push_back(node.firstChild + q);
         }
     }
 
+    nodes.clear(); // Keeps the allocator and its memory policy
+    nodes.emplace_back(boundary);
+    overflowPoints.clear();
+    overflowStamps.clear();
+    freeGroups.clear();
+    if (timed) stamps.assign(1, Stamps());
+    for (const auto &[point, stamp] : points) insertFrom(0, point, stamp);
+}
 
+// Subdivides nodes[index] into four child nodes, reusing a sibling group released by expiry when there is one
+void QuadTree::subdivide(const int index) {
+    const Rect boundary = nodes[index].boundary;
+    const int depth = nodes[index].depth;
+    int first;
+    if (!freeGroups.empty()) {
+        first = freeGroups.back();
+        freeGroups.pop_back();
+        for (int q = 0; q < 4; ++q) {
+            nodes[first + q] = Node(quadrantRect(boundary, q), depth + 1);
+        }
+    } else {
+        first = static_cast<int>(nodes.size());
+        for (int q = 0; q < 4; ++q) {
+            nodes.emplace_back(quadrantRect(boundary, q), depth + 1); // May reallocate the arena, hence the copies above
+        }
+    }
+    for (int q = 0; q < 4; ++q) nodes[first + q].parent = index;
+    if (timed) {
+        stamps.resize(nodes.size());
+        for (int q = 0; q < 4; ++q) stamps[first + q] = Stamps();
+    }
+
+    Node &node = nodes[index];
+    node.firstChild = first;
+    const std::array<Point, CAPACITY> moved = node.points;
+    const std::array<double, CAPACITY> movedStamps = timed ? stamps[index].points : Stamps().points;
+    const int count = node.point_count;
+    node.point_count = 0; // Clear the points from this node after redistribution
 
-    point_count = 0; // Clear the points from this node after redistribution
-    divided = true;  // Mark the node as subdivided
+    // Redistribute points from the parent node straight into the child each one falls in
+    for (int i = 0; i < count; ++i) {
+        insertFrom(first + quadrantOf(boundary, moved[i]), moved[i], movedStamps[i]);
+    }
 }
 
+// Overflow list of a leaf that reached MAX_DEPTH, created on first use
+std::vector<Point> &QuadTree::overflowList(Node &node) {
+    if (node.overflow < 0) {
+        node.overflow = static_cast<int>(overflowPoints.size());
+        overflowPoints.emplace_back();
+        if (timed) overflowStamps.emplace_back();
+    }
+    return overflowPoints[node.overflow];
+}
 
 // Inserts a point into the QuadTree, subdividing if necessary
+// Follows the root through the growth steps insert would take, without changing the tree
+bool QuadTree::accepts(const Point &point) const {
+    Rect boundary = nodes[0].boundary;
+    for (int step = 0; growable && step < 64 && !boundary.contains(point); ++step) {
+        if (boundary.w <= 0.0f || boundary.h <= 0.0f) break;
+        int quadrant;
+        boundary = grownBoundary(boundary, point, quadrant);
+    }
+    return boundary.contains(point);
+}
+
 bool QuadTree::insert(const Point &point) {
-    if (!boundary.contains(point)) {
-        return false; // Point is outside the current boundary
+    // A growable root doubles toward the point, each step a constant-time re-parenting
+    for (int step = 0; growable && step < 64 && !nodes[0].boundary.contains(point); ++step) {
+        if (!growToward(point)) break;
+    }
+    if (!nodes[0].boundary.contains(point)) {
+        return false; // Point is outside the root boundary
+    }
+    insertFrom(0, point, NEVER);
+    return true;
+}
+
+// Inserts a point that expires once expireOlderThan is called with a cutoff after timestamp
+bool QuadTree::insert(const Point &point, const double timestamp) {
+    if (!timed) enableTimestamps();
+    for (int step = 0; growable && step < 64 && !nodes[0].boundary.contains(point); ++step) {
+        if (!growToward(point)) break;
+    }
+    if (!nodes[0].boundary.contains(point)) {
+        return false; // Point is outside the root boundary
+    }
+    insertFrom(0, point, timestamp);
+    return true;
+}
+
+// Stamps every point stored so far NEVER and starts keeping the side arrays in step with the arena
+void QuadTree::enableTimestamps() {
+    timed = true;
+    stamps.assign(nodes.size(), Stamps());
+    overflowStamps.clear();
+    for (const std::vector<Point> &overflow : overflowPoints) {
+        overflowStamps.emplace_back(overflow.size(), NEVER);
     }
+}
+
+void QuadTree::ignoreOlderThan(const double cutoff) {
+    visibleFrom = cutoff;
+}
+
+int QuadTree::insertFrom(int index, const Point &point, const double stamp) {
+    while (true) {
+        Node &node = nodes[index];
+
+        // Start loading the child the descent will take while this node's summary is updated
+        if (prefetchDistance > 0 && node.divided()) {
+            const char *child = reinterpret_cast<const char *>(&nodes[node.firstChild + quadrantOf(node.boundary, point)]);
+            __builtin_prefetch(child, 1, 3);
+            __builtin_prefetch(child + sizeof(Node) - 1, 1, 3);
+        }
 
-    if (point_count < CAPACITY && !divided) {
-        points[point_count] = point; // Store point if within capacity and no subdivision
-        point_count++;
+        // Every node on the insertion path folds the point into its subtree summary
+        ++node.subtreeCount;
+        node.payloadSum += static_cast<double>(point.payload);
+        node.payloadMin = std::min(node.payloadMin, point.payload);
+        node.payloadMax = std::max(node.payloadMax, point.payload);
+        if (timed) stamps[index].oldest = std::min(stamps[index].oldest, stamp);
+
+        if (node.point_count < CAPACITY && !node.divided()) {
+            if (timed) stamps[index].points[node.point_count] = stamp;
+            node.points[node.point_count] = point; // Store point if within capacity and no subdivision
+            node.point_count++;
+            return index;
+        }
+
+        if (!node.divided() && node.depth >= MAX_DEPTH) {
+            // Too deep to split any further, keep the point in this leaf
+            overflowList(node).push_back(point);
+            if (timed) overflowStamps[node.overflow].push_back(stamp);
+            return index;
+        }
+
+        if (!node.divided()) {
+            subdivide(index); // Subdivide if capacity is exceeded; invalidates node
+        }
+        index = nodes[index].firstChild + quadrantOf(nodes[index].boundary, point);
+    }
+}
+
+// Inserts a batch, rejecting the points outside a fixed root; the batch is reordered in place
+size_t QuadTree::insertBatch(std::span<Point> batch) {
+    if (growable) {
+        for (const Point &point : batch) {
+            for (int step = 0; step < 64 && !nodes[0].boundary.contains(point); ++step) {
+                if (!growToward(point)) break;
+            }
+        }
+    }
+
+    // Move the points the root accepts to the front and drop the rest
+    const Rect &boundary = nodes[0].boundary;
+    const auto accepted = std::partition(batch.begin(), batch.end(), [&](const Point &p) { return boundary.contains(p); });
+    const std::span<Point> inside(batch.begin(), accepted);
+    if (!inside.empty()) insertBatchFrom(0, inside);
+    return inside.size();
+}
+
+void QuadTree::insertBatchFrom(const int index, std::span<Point> batch) {
+    {
+        // Fold the whole batch into this node's summary at once
+        Node &node = nodes[index];
+        node.subtreeCount += static_cast<int>(batch.size());
+        for (const Point &p : batch) {
+            node.payloadSum += static_cast<double>(p.payload);
+            node.payloadMin = std::min(node.payloadMin, p.payload);
+            node.payloadMax = std::max(node.payloadMax, p.payload);
+        }
+
+        if (!node.divided()) {
+            // Batched points carry no timestamp and never expire
+            if (node.point_count + static_cast<int>(batch.size()) <= CAPACITY) {
+                std::ranges::copy(batch, node.points.begin() + node.point_count);
+                if (timed) std::fill_n(stamps[index].points.begin() + node.point_count, batch.size(), NEVER);
+                node.point_count += static_cast<int>(batch.size());
+                return;
+            }
+            if (node.depth >= MAX_DEPTH) {
+                // Too deep to split any further, fill the leaf and keep the rest in its overflow list
+                const size_t stored = static_cast<size_t>(CAPACITY - node.point_count);
+                std::ranges::copy(batch.first(stored), node.points.begin() + node.point_count);
+                if (timed) std::fill_n(stamps[index].points.begin() + node.point_count, stored, NEVER);
+                node.point_count = CAPACITY;
+                std::vector<Point> &overflow = overflowList(node);
+                overflow.insert(overflow.end(), batch.begin() + static_cast<std::ptrdiff_t>(stored), batch.end());
+                if (timed) overflowStamps[node.overflow].resize(overflow.size(), NEVER);
+                return;
+            }
+            subdivide(index); // Split once for the whole batch; invalidates node
+        }
+    }
+
+    // Partition in place by quadrant, first into north and south and then each half into east and west,
+    // so the four groups come out in quadrant order
+    const Rect boundary = nodes[index].boundary;
+    const auto south = std::partition(batch.begin(), batch.end(), [&](const Point &p) { return p.y <= boundary.y; });
+    const auto northWest = std::partition(batch.begin(), south, [&](const Point &p) { return p.x >= boundary.x; });
+    const auto southWest = std::partition(south, batch.end(), [&](const Point &p) { return p.x >= boundary.x; });
+
+    const std::array<std::span<Point>, 4> groups = {
+        std::span<Point>(batch.begin(), northWest),
+        std::span<Point>(northWest, south),
+        std::span<Point>(south, southWest),
+        std::span<Point>(southWest, batch.end()),
+    };
+    for (int q = 0; q < 4; ++q) {
+        // Only children that receive points are visited; the arena may grow, so re-read the child index
+        if (!groups[q].empty()) insertBatchFrom(nodes[index].firstChild + q, groups[q]);
+    }
+}
+
+// Progress of one expireOlderThan call against its time budget
+struct QuadTree::ExpirySweep {
+    double cutoff;
+    bool bounded; // False when the budget is unlimited
+    std::chrono::steady_clock::time_point deadline;
+    size_t visited = 0;
+    size_t removed = 0;
+    bool stopped = false;
+
+    // Reading the clock costs more than visiting a node, so it is only read every few nodes. The budget is
+    // only enforced once something was removed, so every call makes progress however deep the stale points lie.
+    bool outOfTime() {
+        if (!stopped && bounded && removed > 0 && ++visited % 16 == 0) stopped = std::chrono::steady_clock::now() >= deadline;
+        return stopped;
+    }
+};
+
+bool QuadTree::expireOlderThan(const double cutoff, const std::chrono::microseconds budget, size_t &removed) {
+    removed = 0;
+    if (!timed) return true; // Nothing was ever stamped, so nothing expires
+
+    const bool bounded = budget != std::chrono::microseconds::max();
+    ExpirySweep sweep{cutoff, bounded, std::chrono::steady_clock::now() + (bounded ? budget : std::chrono::microseconds(0))};
+    expire_rec(0, sweep);
+    removed = sweep.removed;
+    return stamps[0].oldest >= cutoff;
+}
+
+void QuadTree::expire_rec(const int index, ExpirySweep &sweep) {
+    // Subtrees with nothing older than the cutoff are skipped without being entered
+    if (stamps[index].oldest >= sweep.cutoff || sweep.outOfTime()) return;
+
+    // Compact the points that stay, keeping every stamp next to its point; slots past the end hold NEVER
+    Node &node = nodes[index];
+    Stamps &stamp = stamps[index];
+    int kept = 0;
+    for (int i = 0; i < node.point_count; ++i) {
+        if (stamp.points[i] < sweep.cutoff) continue;
+        node.points[kept] = node.points[i];
+        stamp.points[kept] = stamp.points[i];
+        ++kept;
+    }
+    std::fill(stamp.points.begin() + kept, stamp.points.end(), NEVER);
+    sweep.removed += static_cast<size_t>(node.point_count - kept);
+    node.point_count = kept;
+
+    if (node.overflow >= 0) {
+        std::vector<Point> &overflow = overflowPoints[node.overflow];
+        std::vector<double> &overflowStamp = overflowStamps[node.overflow];
+        size_t keptOverflow = 0;
+        for (size_t i = 0; i < overflow.size(); ++i) {
+            if (overflowStamp[i] < sweep.cutoff) continue;
+            overflow[keptOverflow] = overflow[i];
+            overflowStamp[keptOverflow] = overflowStamp[i];
+            ++keptOverflow;
+        }
+        sweep.removed += overflow.size() - keptOverflow;
+        overflow.resize(keptOverflow);
+        overflowStamp.resize(keptOverflow);
+    }
+
+    // The arena does not grow during a sweep, so node stays valid across the recursion
+    if (node.divided()) {
+        for (int q = 0; q < 4; ++q) expire_rec(node.firstChild + q, sweep);
+    }
+    summarize(index);
+    collapse(index);
+}
+
+// Recomputes a node's summary from its own points and its children's summaries
+void QuadTree::summarize(const int index) {
+    Node &node = nodes[index];
+    node.subtreeCount = 0;
+    node.payloadSum = 0.0;
+    node.payloadMin = std::numeric_limits<float>::max();
+    node.payloadMax = std::numeric_limits<float>::lowest();
+    double oldest = NEVER;
+
+    auto add = [&](const Point &p, const double stamp) {
+        ++node.subtreeCount;
+        node.payloadSum += static_cast<double>(p.payload);
+        node.payloadMin = std::min(node.payloadMin, p.payload);
+        node.payloadMax = std::max(node.payloadMax, p.payload);
+        oldest = std::min(oldest, stamp);
+    };
+    for (int i = 0; i < node.point_count; ++i) add(node.points[i], timed ? stamps[index].points[i] : NEVER);
+    if (node.overflow >= 0) {
+        for (size_t i = 0; i < overflowPoints[node.overflow].size(); ++i) add(overflowPoints[node.overflow][i], timed ? overflowStamps[node.overflow][i] : NEVER);
+    }
+    if (node.divided()) {
+        for (int q = 0; q < 4; ++q) {
+            const Node &child = nodes[node.firstChild + q];
+            node.subtreeCount += child.subtreeCount;
+            node.payloadSum += child.payloadSum;
+            node.payloadMin = std::min(node.payloadMin, child.payloadMin);
+            node.payloadMax = std::max(node.payloadMax, child.payloadMax);
+            if (timed) oldest = std::min(oldest, stamps[node.firstChild + q].oldest);
+        }
+    }
+    if (timed) stamps[index].oldest = oldest;
+}
+
+// Pulls the points of four leaf children back into their parent once they fit, releasing the sibling group
+void QuadTree::collapse(const int index) {
+    Node &node = nodes[index];
+    if (!node.divided() || node.subtreeCount > CAPACITY) return;
+    const int first = node.firstChild;
+    for (int q = 0; q < 4; ++q) {
+        const Node &child = nodes[first + q];
+        if (child.divided() || !overflowOf(child).empty()) return;
+    }
+
+    node.point_count = 0;
+    if (timed) std::ranges::fill(stamps[index].points, NEVER);
+    for (int q = 0; q < 4; ++q) {
+        const Node &child = nodes[first + q];
+        for (int i = 0; i < child.point_count; ++i) {
+            node.points[node.point_count] = child.points[i];
+            if (timed) stamps[index].points[node.point_count] = stamps[first + q].points[i];
+            ++node.point_count;
+        }
+    }
+    node.firstChild = -1;
+    for (int q = 0; q < 4; ++q) nodes[first + q].parent = RELEASED; // Stale handles to them restart at the root
+    freeGroups.push_back(first);
+}
+
+bool QuadTree::remove(const Point &point) {
+    double stamp;
+    return remove_rec(0, point, false, stamp);
+}
+
+bool QuadTree::removeExact(const Point &point) {
+    double stamp;
+    return remove_rec(0, point, true, stamp);
+}
+
+bool QuadTree::move(const Point &from, const Point &to) {
+    return moveMatching(from, to, false);
+}
+
+bool QuadTree::moveExact(const Point &from, const Point &to) {
+    return moveMatching(from, to, true);
+}
+
+// Removes from and inserts back at the root, so the moved point keeps its timestamp
+bool QuadTree::moveMatching(const Point &from, const Point &to, const bool exact) {
+    for (int step = 0; growable && step < 64 && !nodes[0].boundary.contains(to); ++step) {
+        if (!growToward(to)) break;
+    }
+    double stamp;
+    if (!nodes[0].boundary.contains(to) || !remove_rec(0, from, exact, stamp)) return false;
+    insertFrom(0, to, stamp);
+    return true;
+}
+
+bool QuadTree::remove_rec(const int index, const Point &point, const bool exact, double &stamp) {
+    if (nodes[index].subtreeCount == 0 || !nodes[index].boundary.contains(point)) return false;
+
+    auto matches = [&](const Point &stored) { return stored == point && (!exact || stored.payload == point.payload); };
+    Node &node = nodes[index];
+    bool found = false;
+    for (int i = 0; i < node.point_count && !found; ++i) {
+        if (!matches(node.points[i])) continue;
+        // Close the gap, keeping every stamp next to its point
+        stamp = timed ? stamps[index].points[i] : NEVER;
+        for (int j = i + 1; j < node.point_count; ++j) {
+            node.points[j - 1] = node.points[j];
+            if (timed) stamps[index].points[j - 1] = stamps[index].points[j];
+        }
+        --node.point_count;
+        if (timed) stamps[index].points[node.point_count] = NEVER;
+        found = true;
+    }
+    if (!found && node.overflow >= 0) {
+        std::vector<Point> &overflow = overflowPoints[node.overflow];
+        for (size_t i = 0; i < overflow.size() && !found; ++i) {
+            if (!matches(overflow[i])) continue;
+            stamp = timed ? overflowStamps[node.overflow][i] : NEVER;
+            overflow.erase(overflow.begin() + static_cast<std::ptrdiff_t>(i));
+            if (timed) overflowStamps[node.overflow].erase(overflowStamps[node.overflow].begin() + static_cast<std::ptrdiff_t>(i));
+            found = true;
+        }
+    }
+
+    // The insert path holds the point unless it lies on an edge the root was grown across,
+    // so the other quadrants whose boundary contains it are only tried after that one
+    if (!found && node.divided()) {
+        const int first = node.firstChild;
+        const int preferred = quadrantOf(node.boundary, point);
+        found = remove_rec(first + preferred, point, exact, stamp);
+        for (int q = 0; q < 4 && !found; ++q) {
+            if (q != preferred) found = remove_rec(first + q, point, exact, stamp);
+        }
+    }
+    if (found) {
+        summarize(index);
+        collapse(index);
+    }
+    return found;
+}
+
+int QuadTree::climbFrom(const int handle, const Point &point) const {
+    if (handle <= 0 || handle >= static_cast<int>(nodes.size()) || nodes[handle].parent == RELEASED) return 0;
+    int index = handle;
+    while (index != 0 && !nodes[index].boundary.contains(point)) index = nodes[index].parent;
+    return index;
+}
+
+void QuadTree::addToAncestors(const int index, const Point &point, const double stamp) {
+    for (int above = nodes[index].parent; above >= 0; above = nodes[above].parent) {
+        Node &node = nodes[above];
+        ++node.subtreeCount;
+        node.payloadSum += static_cast<double>(point.payload);
+        node.payloadMin = std::min(node.payloadMin, point.payload);
+        node.payloadMax = std::max(node.payloadMax, point.payload);
+        if (timed) stamps[above].oldest = std::min(stamps[above].oldest, stamp);
+    }
+}
+
+// The same fix-up remove_rec applies on its way back up; a collapse only releases the group just left,
+// after which the ancestor that absorbed it is the lowest node of the path still in the tree
+int QuadTree::repairAncestors(const int index) {
+    int lowest = index;
+    for (int above = nodes[index].parent; above >= 0; above = nodes[above].parent) {
+        summarize(above);
+        collapse(above);
+        if (!nodes[above].divided()) lowest = above;
+    }
+    return lowest;
+}
+
+// Descends like locate(point, Rect &), reporting the arena index instead of the boundary
+bool QuadTree::locate(const Point &point, LeafHandle &leaf) const {
+    if (!nodes[0].boundary.contains(point)) return false;
+
+    int index = 0;
+    while (nodes[index].divided()) {
+        index = nodes[index].firstChild + quadrantOf(nodes[index].boundary, point);
+    }
+    leaf.node = index;
+    return true;
+}
+
+// Descends from the lowest ancestor of the handle's leaf containing point, so only the nodes above it
+// are updated by a climb; a point on that ancestor's edge may be stored there rather than on the
+// root's quadrant path, which remove and every query already allow for
+bool QuadTree::insert(const Point &point, LeafHandle &leaf) {
+    for (int step = 0; growable && step < 64 && !nodes[0].boundary.contains(point); ++step) {
+        if (!growToward(point)) break;
+    }
+    if (!nodes[0].boundary.contains(point)) {
+        return false; // Point is outside the root boundary
+    }
+    const int start = climbFrom(leaf.node, point);
+    leaf.node = insertFrom(start, point, NEVER);
+    if (start != 0) addToAncestors(start, point, NEVER);
+    return true;
+}
+
+// Searches the subtree of the lowest ancestor containing point, then the whole tree if the point was not there
+bool QuadTree::remove(const Point &point, const LeafHandle &leaf) {
+    const int start = climbFrom(leaf.node, point);
+    double stamp;
+    if (start != 0 && remove_rec(start, point, false, stamp)) {
+        repairAncestors(start);
         return true;
     }
+    return remove_rec(0, point, false, stamp);
+}
 
-    if (!divided) {
-        subdivide(); // Subdivide if capacity is exceeded
+bool QuadTree::move(const Point &from, const Point &to, LeafHandle &leaf) {
+    for (int step = 0; growable && step < 64 && !nodes[0].boundary.contains(to); ++step) {
+        if (!growToward(to)) break;
     }
+    if (!nodes[0].boundary.contains(to)) return false;
 
-    // Try to insert the point into one of the child nodes
-    if (northeast->insert(point)) return true;
-    if (northwest->insert(point)) return true;
-    if (southeast->insert(point)) return true;
-    if (southwest->insert(point)) return true;
+    // Climb toward to from the lowest node the removal left in place, or from the handle if it had to
+    // search the whole tree
+    const int start = climbFrom(leaf.node, from);
+    double stamp;
+    int lowest = leaf.node;
+    if (start != 0 && remove_rec(start, from, false, stamp)) {
+        lowest = repairAncestors(start);
+    } else if (!remove_rec(0, from, false, stamp)) {
+        return false;
+    }
+    const int next = climbFrom(lowest, to);
+    leaf.node = insertFrom(next, to, stamp);
+    if (next != 0) addToAncestors(next, to, stamp);
+    return true;
+}
 
-    return false;
+void QuadTree::setMemoryPolicy(const MemoryPolicy &policy) {
+    if (policy == nodes.get_allocator().policy) return;
+    NodeArena moved{PageAllocator<Node>(policy)};
+    moved.reserve(nodes.capacity());
+    moved.assign(nodes.begin(), nodes.end());
+    nodes = std::move(moved);
+}
+
+MemoryPolicy QuadTree::getMemoryPolicy() const {
+    return nodes.get_allocator().policy;
+}
+
+// Walks the same quadrant path as insert down to a leaf
+bool QuadTree::locate(const Point &point, Rect &leaf) const {
+    if (!nodes[0].boundary.contains(point)) return false;
+
+    const Node *node = &nodes[0];
+    while (node->divided()) {
+        node = &childrenOf(*node)[quadrantOf(node->boundary, point)];
+    }
+    leaf = node->boundary;
+    return true;
+}
+
+void QuadTree::setPrefetchDistance(const int distance) {
+    prefetchDistance = std::max(0, distance);
+}
+
+int QuadTree::getPrefetchDistance() const {
+    return prefetchDistance;
+}
+
+// Lays out the sibling groups of the tree in van Emde Boas order: the top half of the levels first,
+// then every bottom subtree recursively, so any path of depth d touches O(log d) contiguous blocks
+void QuadTree::optimize() {
+    // A group is the root alone or the four children of a divided node; groups form a tree of their own
+    std::vector<int> height(nodes.size(), 0); // Group height, indexed by the arena index of the group's first node
+    auto measure = [&](auto &&self, const int first, const int size) -> int {
+        int below = 0;
+        for (int k = 0; k < size; ++k) {
+            if (nodes[first + k].divided()) below = std::max(below, self(self, nodes[first + k].firstChild, 4));
+        }
+        return height[first] = below + 1;
+    };
+    measure(measure, 0, 1);
+
+    NodeArena laid(nodes.get_allocator());
+    laid.reserve(nodes.size());
+    std::vector<int> moved(nodes.size(), -1); // Old arena index to new arena index
+
+    // Collects the groups exactly `levels` group levels below the given group, left to right
+    auto collect = [&](auto &&self, const int first, const int size, const int levels, std::vector<int> &out) -> void {
+        for (int k = 0; k < size; ++k) {
+            const Node &node = nodes[first + k];
+            if (!node.divided()) continue;
+            if (levels == 1) out.push_back(node.firstChild);
+            else self(self, node.firstChild, 4, levels - 1, out);
+        }
+    };
+
+    auto layout = [&](auto &&self, const int first, const int size, const int levels) -> void {
+        if (levels == 1) {
+            for (int k = 0; k < size; ++k) {
+                moved[first + k] = static_cast<int>(laid.size());
+                laid.push_back(nodes[first + k]);
+            }
+            return;
+        }
+        const int top = (levels + 1) / 2;
+        self(self, first, size, top);
+
+        std::vector<int> bottoms;
+        collect(collect, first, size, top, bottoms);
+        for (const int bottom : bottoms) {
+            self(self, bottom, 4, std::min(levels - top, height[bottom]));
+        }
+    };
+    layout(layout, 0, 1, height[0]);
+
+    // Siblings were copied as one block, so remapping the first child keeps the group contiguous
+    for (Node &node : laid) {
+        if (node.divided()) node.firstChild = moved[node.firstChild];
+        if (node.parent >= 0) node.parent = moved[node.parent];
+    }
+    if (timed) {
+        std::vector<Stamps> laidStamps(laid.size());
+        for (size_t i = 0; i < moved.size(); ++i) {
+            if (moved[i] >= 0) laidStamps[static_cast<size_t>(moved[i])] = stamps[i];
+        }
+        stamps.swap(laidStamps);
+    }
+    nodes.swap(laid);
+    freeGroups.clear(); // Released groups were unreachable and have not been copied
+}
+
+// Aggregates the payloads of all points inside range
+PayloadAggregate QuadTree::aggregate(const Rect &range) const {
+    PayloadAggregate result;
+    aggregate_rec(nodes[0], range, result);
+    return result;
+}
+
+void QuadTree::aggregate_rec(const Node &node, const Rect &range, PayloadAggregate &result) const {
+    if (node.subtreeCount == 0 || !node.boundary.intersects(range)) return;
+
+    // A node fully covered by the range contributes its summary without being descended
+    if (range.contains(node.boundary)) {
+        result.merge(PayloadAggregate{node.subtreeCount, node.payloadSum, node.payloadMin, node.payloadMax});
+        return;
+    }
+
+    for (int i = 0; i < node.point_count; ++i) {
+        if (range.contains(node.points[i])) result.add(node.points[i]);
+    }
+    for (const Point &p : overflowOf(node)) {
+        if (range.contains(p)) result.add(p);
+    }
+
+    if (node.divided()) {
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) aggregate_rec(children[q], range, result);
+    }
+}
+
+struct QuadTree::RasterBand {
+    float left, top; // World coordinates of the grid's top-left corner
+    float pixelWidth, pixelHeight;
+    int width, height;
+    int rowBegin, rowEnd; // Rows [rowBegin, rowEnd) belong to this band
+    Rect bounds; // World rectangle covered by the band, used to prune nodes
+    std::uint32_t* output;
+
+    [[nodiscard]] int column(const float x) const {
+        const int c = static_cast<int>(std::floor((x - left) / pixelWidth));
+        return c == width && x <= left + pixelWidth * static_cast<float>(width) ? width - 1 : c; // Right edge is inclusive
+    }
+
+    [[nodiscard]] int row(const float y) const {
+        const int r = static_cast<int>(std::floor((y - top) / pixelHeight));
+        return r == height && y <= top + pixelHeight * static_cast<float>(height) ? height - 1 : r; // Bottom edge is inclusive
+    }
+
+    // Adds count to the pixel at (c, r) if it lies in this band
+    void add(const int c, const int r, const int count) const {
+        if (c >= 0 && c < width && r >= rowBegin && r < rowEnd) {
+            output[static_cast<size_t>(r) * static_cast<size_t>(width) + static_cast<size_t>(c)] += static_cast<std::uint32_t>(count);
+        }
+    }
+};
+
+// Rasterizes the point density of view, one band of rows per worker thread
+bool QuadTree::rasterize(const Rect &view, const int width, const int height, std::span<std::uint32_t> output, unsigned threads) const {
+    if (width <= 0 || height <= 0 || output.size() < static_cast<size_t>(width) * static_cast<size_t>(height)) {
+        return false;
+    }
+    std::fill_n(output.begin(), static_cast<size_t>(width) * static_cast<size_t>(height), 0u);
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, static_cast<unsigned>(height));
+
+    const float pixelWidth = 2.0f * view.w / static_cast<float>(width);
+    const float pixelHeight = 2.0f * view.h / static_cast<float>(height);
+    const float top = view.y - view.h;
+
+    std::vector<RasterBand> bands;
+    for (unsigned t = 0; t < threads; ++t) {
+        const int rowBegin = static_cast<int>(static_cast<long long>(height) * t / threads);
+        const int rowEnd = static_cast<int>(static_cast<long long>(height) * (t + 1) / threads);
+        const float bandTop = top + pixelHeight * static_cast<float>(rowBegin);
+        const float bandHalf = pixelHeight * static_cast<float>(rowEnd - rowBegin) / 2.0f;
+        bands.push_back(RasterBand{view.x - view.w, top, pixelWidth, pixelHeight, width, height, rowBegin, rowEnd,
+                                   Rect(view.x, bandTop + bandHalf, view.w, bandHalf), output.data()});
+    }
+
+    // Bands own disjoint rows, so the workers never write the same pixel
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < bands.size(); ++t) {
+        workers.emplace_back([this, &band = bands[t]] { rasterize_rec(nodes[0], band); });
+    }
+    rasterize_rec(nodes[0], bands[0]);
+    for (std::thread &worker : workers) worker.join();
+    return true;
+}
+
+void QuadTree::rasterize_rec(const Node &node, const RasterBand &band) const {
+    const Rect &boundary = node.boundary;
+    if (node.subtreeCount == 0 || !boundary.intersects(band.bounds)) return;
+
+    // A node that falls within a single pixel adds its whole count to that pixel
+    const int c0 = band.column(boundary.x - boundary.w);
+    const int c1 = band.column(boundary.x + boundary.w);
+    const int r0 = band.row(boundary.y - boundary.h);
+    const int r1 = band.row(boundary.y + boundary.h);
+    if (c0 == c1 && r0 == r1) {
+        band.add(c0, r0, node.subtreeCount);
+        return;
+    }
+
+    // A node smaller than a pixel is credited to the pixel holding its centre instead of being descended
+    if (2.0f * boundary.w <= band.pixelWidth && 2.0f * boundary.h <= band.pixelHeight) {
+        band.add(band.column(boundary.x), band.row(boundary.y), node.subtreeCount);
+        return;
+    }
+
+    for (int i = 0; i < node.point_count; ++i) band.add(band.column(node.points[i].x), band.row(node.points[i].y), 1);
+    for (const Point &p : overflowOf(node)) band.add(band.column(p.x), band.row(p.y), 1);
+
+    if (node.divided()) {
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) rasterize_rec(children[q], band);
+    }
+}
+
+// Slab test against the box grown by tolerance; axis-parallel rays are handled without dividing by zero
+bool QuadTree::clipRay(const Rect &box, const Point &origin, const Point &dir, const float tolerance, float &tEnter, float &tExit) {
+    tEnter = std::numeric_limits<float>::lowest();
+    tExit = std::numeric_limits<float>::max();
+
+    auto slab = [&](const float o, const float d, const float centre, const float half) {
+        const float lo = centre - half - tolerance;
+        const float hi = centre + half + tolerance;
+        if (std::abs(d) < 1e-12f) return o >= lo && o <= hi; // Parallel to the slab: inside it or never
+        float t0 = (lo - o) / d;
+        float t1 = (hi - o) / d;
+        if (t0 > t1) std::swap(t0, t1);
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+        return tEnter <= tExit;
+    };
+    return slab(origin.x, dir.x, box.x, box.w) && slab(origin.y, dir.y, box.y, box.h);
+}
+
+// Casts a ray and reports the point with the smallest projection within tolerance of it
+bool QuadTree::raycast(const Point &origin, const Point &dir, const float maxT, const float tolerance, RayHit &hit) const {
+    const float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+    if (length == 0.0f || nodes[0].subtreeCount == 0) return false;
+    const Point unit(dir.x / length, dir.y / length);
+
+    float tEnter, tExit;
+    if (!clipRay(nodes[0].boundary, origin, unit, tolerance, tEnter, tExit) || tExit < 0.0f || tEnter > maxT) return false;
+
+    bool found = false;
+    hit.t = maxT;
+    raycast_rec(nodes[0], origin, unit, maxT, tolerance, tEnter, hit, found);
+    return found;
+}
+
+void QuadTree::raycast_rec(const Node &node, const Point &origin, const Point &dir, const float maxT, const float tolerance,
+                           const float tEnter, RayHit &hit, bool &found) const {
+    const float tolerance2 = tolerance * tolerance;
+    auto test = [&](const Point &p) {
+        const float ox = p.x - origin.x;
+        const float oy = p.y - origin.y;
+        const float t = ox * dir.x + oy * dir.y; // Projection of the point onto the ray
+        if (t < 0.0f || t > hit.t || (found && t == hit.t)) return;
+        if (ox * ox + oy * oy - t * t <= tolerance2) {
+            hit.point = p;
+            hit.t = t;
+            found = true;
+        }
+    };
+    const bool hiding = hidingStale();
+    for (int i = 0; i < node.point_count; ++i) {
+        if (!(hiding && hidden(node, i))) test(node.points[i]);
+    }
+    const std::span<const Point> overflow = overflowOf(node);
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        if (!(hiding && hidden(node, node.point_count + static_cast<int>(i)))) test(overflow[i]);
+    }
+
+    if (!node.divided()) return;
+
+    // Order the crossed children by where the ray enters them
+    std::array<std::pair<float, const Node*>, 4> crossed;
+    int count = 0;
+    const Node *children = childrenOf(node);
+    for (int q = 0; q < 4; ++q) {
+        const Node *child = &children[q];
+        float enter, exit;
+        if (child->subtreeCount == 0 || !clipRay(child->boundary, origin, dir, tolerance, enter, exit)) continue;
+        if (exit < 0.0f || enter > maxT) continue;
+        // Insertion sort keyed by the entry parameter, at most four children
+        const float key = std::max(enter, tEnter);
+        int slot = count++;
+        for (; slot > 0 && crossed[slot - 1].first > key; --slot) crossed[slot] = crossed[slot - 1];
+        crossed[slot] = {key, child};
+    }
+
+    for (int i = 0; i < count; ++i) {
+        // A hit's projection lies inside the grown box it came from, so later boxes cannot beat it
+        if (found && crossed[i].first > hit.t) break;
+        raycast_rec(*crossed[i].second, origin, dir, maxT, tolerance, crossed[i].first, hit, found);
+    }
+}
+
+bool QuadTree::pointInPolygon(std::span<const Point> vertices, const Point &p) {
+    bool inside = false;
+    for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+        const Point &a = vertices[j];
+        const Point &b = vertices[i];
+        // Side of p relative to the edge, compared without dividing by the edge's height
+        const float side = (p.x - a.x) * (b.y - a.y) - (b.x - a.x) * (p.y - a.y);
+        if ((a.y > p.y) != (b.y > p.y) && (side < 0.0f) == (b.y > a.y)) inside = !inside;
+    }
+    return inside;
 }
 
 // Helper method to check if the QuadTree node is subdivided
 bool QuadTree::isDivided() const {
-    return divided;
+    return nodes[0].divided();
 }
 
 int QuadTree::capacity() {
@@ -102,53 +1041,93 @@ int QuadTree::capacity() {
 // Prints the QuadTree structure starting from the root node, color-coded and indented by depth
 void QuadTree::print_quadtree(const int depth) const {
     std::cout << "\033[1;35mLEVEL 0:\n"; // Color output for the top-level node
-    print_quadtree_rec(depth);
+    print_quadtree_rec(nodes[0], depth);
     std::cout << "\033[1;32m"; // Color reset
 }
 
 // Recursive helper function to print the structure of the QuadTree
-void QuadTree::print_quadtree_rec(const int depth) const {
+void QuadTree::print_quadtree_rec(const Node &node, const int depth) const {
     // Prints indentation corresponding to the current depth of recursion
     auto print_indent = [](const int d) {
         for (int i = 0; i < d; ++i) std::cout << "    "; // Indentation: 4 spaces per depth level
     };
 
+    const Rect &boundary = node.boundary;
     print_indent(depth);
     std::cout << "Boundary: (" << boundary.x << ", " << boundary.y << ", " << boundary.w << ", " << boundary.h << ")\n";
 
     print_indent(depth);
     std::cout << "Points: ";
-    for (int i = 0; i < point_count; ++i) {
-        std::cout << "(" << points[i].x << ", " << points[i].y << ", " << points[i].payload << ") "; // Prints the stored points with payload
+    for (int i = 0; i < node.point_count; ++i) {
+        std::cout << "(" << node.points[i].x << ", " << node.points[i].y << ", " << node.points[i].payload << ") "; // Prints the stored points with payload
+    }
+    for (const Point &p : overflowOf(node)) {
+        std::cout << "(" << p.x << ", " << p.y << ", " << p.payload << ") ";
     }
     std::cout << "\n";
 
-    if (divided) { // If the node has been subdivided, recursively print each quadrant
+    if (node.divided()) { // If the node has been subdivided, recursively print each quadrant
         print_indent(depth);
         std::cout << "LEVEL " << depth + 1 << ":\n";
 
-        if (northeast) {
+        static constexpr std::array<const char*, 4> labels = { "- NE:\n", "- NW:\n", "- SE:\n", "- SW:\n" };
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) {
             print_indent(depth);
-            std::cout << "- NE:\n";
-            northeast->print_quadtree_rec(depth + 1);
+            std::cout << labels[q];
+            print_quadtree_rec(children[q], depth + 1);
         }
+    }
+}
 
-        if (northwest) {
-            print_indent(depth);
-            std::cout << "- NW:\n";
-            northwest->print_quadtree_rec(depth + 1);
+// Starts an incremental search from the root of the tree
+NearestNeighborIterator::NearestNeighborIterator(const QuadTree &tree, const Point &target) : tree(&tree), target(target) {
+    if (tree.nodes[0].subtreeCount > 0) {
+        queue.emplace(&tree.nodes[0], 0.0f);
+    }
+}
+
+bool NearestNeighborIterator::next(Point &point) {
+    float distSq;
+    return next(point, distSq);
+}
+
+// Expands nodes until a point reaches the front of the queue; every node and point is pushed and popped once
+bool NearestNeighborIterator::next(Point &point, float &distSq) {
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+        const QuadTree::Node* node = item.node;
+
+        // A point at the front is closer than anything left in the queue
+        if (item.index >= 0) {
+            point = item.index < node->point_count ? node->points[item.index]
+                                                   : tree->overflowOf(*node)[item.index - node->point_count];
+            distSq = item.distance;
+            return true;
         }
 
-        if (southeast) {
-            print_indent(depth);
-            std::cout << "- SE:\n";
-            southeast->print_quadtree_rec(depth + 1);
+        // Push the node's own points with their exact distances, leaving out those ignoreOlderThan hides
+        const bool hiding = tree->hidingStale();
+        for (int i = 0; i < node->point_count; ++i) {
+            if (hiding && tree->hidden(*node, i)) continue;
+            queue.emplace(node, distanceSquared(target, node->points[i]), i);
+        }
+        const std::span<const Point> overflow = tree->overflowOf(*node);
+        for (size_t i = 0; i < overflow.size(); ++i) {
+            const int slot = node->point_count + static_cast<int>(i);
+            if (hiding && tree->hidden(*node, slot)) continue;
+            queue.emplace(node, distanceSquared(target, overflow[i]), slot);
         }
 
-        if (southwest) {
-            print_indent(depth);
-            std::cout << "- SW:\n";
-            southwest->print_quadtree_rec(depth + 1);
+        // Push the non-empty children keyed by their minimum distance to the target
+        if (node->divided()) {
+            const QuadTree::Node *children = tree->childrenOf(*node);
+            for (int q = 0; q < 4; ++q) {
+                if (children[q].subtreeCount == 0) continue;
+                queue.emplace(&children[q], distanceSquared(target, children[q].boundary));
+            }
         }
     }
-}
\ No newline at end of file
+    return false;
+}
@@ -1,10 +1,19 @@
 #ifndef QUADTREE_H
 #define QUADTREE_H
 
+#include <algorithm>
 #include <array>
-#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <queue>
+#include <span>
+
+#include "NearestHeap.hpp"
+#include "Orthant.hpp"
+#include "PageAllocator.hpp"
 
 struct QueueItem;
 
@@ -18,6 +27,8 @@ struct Point {
           payload(payload) {
     }
 
+    [[nodiscard]] Coords<2> coords() const { return {x, y}; } // The coordinates for the shared D-dimensional geometry
+
     bool operator==(const Point &other) const; // Check for equality of two points
     bool operator<(const Point &other) const; // Comparison based on coordinates
     bool operator!=(const Point &other) const; // Check for inequality of two points
@@ -34,62 +45,484 @@ struct Rect {
           h(h) {
     }
 
+    [[nodiscard]] Coords<2> centre() const { return {x, y}; }
+    [[nodiscard]] Coords<2> half() const { return {w, h}; }
+
     [[nodiscard]] bool contains(const Point &p) const; // Check if a point is within the rectangle
     [[nodiscard]] bool intersects(const Rect &range) const; // Check if two rectangles overlap
+    [[nodiscard]] bool contains(const Rect &other) const; // Check if another rectangle lies entirely within this one
+
+    bool operator==(const Rect &other) const; // Check for equality of centre and extents
+};
+
+// Rectangle spanning [left, right] x [top, bottom] that contains all four of its edges despite rounding
+Rect rectBetween(float left, float right, float top, float bottom);
+
+// Count, sum, min and max of the payloads of a set of points
+struct PayloadAggregate {
+    long long count = 0;
+    double sum = 0.0;
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+
+    void add(const Point &p); // Fold a single point into the aggregate
+    void merge(const PayloadAggregate &other); // Fold another aggregate into this one
 };
 
 // Inline function to compute squared Euclidean distance between two points (avoids costly square root)
 inline float distanceSquared(const Point &a, const Point &b) {
-    const float dx = a.x - b.x;
-    const float dy = a.y - b.y;
+    return distanceSquared<2>(a.coords(), b.coords());
+}
+
+// First point hit by a ray and its distance along the ray
+struct RayHit {
+    Point point;
+    float t = 0.0f;
+};
+
+// Squared distance from a point to the closest point of a rectangle, zero when it lies inside
+inline float distanceSquared(const Point &p, const Rect &r) {
+    return distanceSquared<2>(p.coords(), r.centre(), r.half());
+}
+
+// Squared distance between the closest edges of two rectangles, zero when they overlap
+inline float distanceSquared(const Rect &a, const Rect &b) {
+    const float dx = std::max(0.0f, std::abs(a.x - b.x) - a.w - b.w);
+    const float dy = std::max(0.0f, std::abs(a.y - b.y) - a.h - b.h);
     return dx * dx + dy * dy;
 }
 
+// Distance policies for nearestNeighborsBy. key(a, b) orders points by distance and may be any increasing
+// function of it (squared for Euclidean, so no square root is taken); lowerBound(p, r) never exceeds the key
+// from p to any point inside r, which keeps pruning correct, and is exact where cheap so it stays tight.
+struct EuclideanMetric {
+    static float key(const Point &a, const Point &b) { return distanceSquared(a, b); }
+    static float lowerBound(const Point &p, const Rect &r) { return distanceSquared(p, r); }
+};
+
+struct ManhattanMetric {
+    static float key(const Point &a, const Point &b) { return std::abs(a.x - b.x) + std::abs(a.y - b.y); }
+    static float lowerBound(const Point &p, const Rect &r) {
+        return std::max(0.0f, std::abs(p.x - r.x) - r.w) + std::max(0.0f, std::abs(p.y - r.y) - r.h);
+    }
+};
+
+struct ChebyshevMetric {
+    static float key(const Point &a, const Point &b) { return std::max(std::abs(a.x - b.x), std::abs(a.y - b.y)); }
+    static float lowerBound(const Point &p, const Rect &r) {
+        return std::max(std::max(0.0f, std::abs(p.x - r.x) - r.w), std::max(0.0f, std::abs(p.y - r.y) - r.h));
+    }
+};
+
+// Great-circle distance for points holding longitude in x and latitude in y, both in degrees.
+// The key is the haversine term sin^2(d / 2R), which grows with the distance d on a sphere of radius R.
+// Longitudes wrap at the antimeridian, so a query near +180 reaches points and nodes near -180.
+struct HaversineMetric {
+    static constexpr float EARTH_RADIUS = 6371008.8f; // Mean Earth radius in meters
+    static constexpr float RADIANS = 0.017453292519943295f; // Radians per degree
+
+    static float key(const Point &a, const Point &b) {
+        const float sinLat = std::sin((b.y - a.y) * RADIANS / 2);
+        const float sinLon = std::sin((b.x - a.x) * RADIANS / 2);
+        return sinLat * sinLat + std::cos(a.y * RADIANS) * std::cos(b.y * RADIANS) * sinLon * sinLon;
+    }
+
+    // Key to the nearest point of the longitude/latitude box r, measured around the shorter side of the globe
+    static float lowerBound(const Point &p, const Rect &r);
+
+    static float meters(const float key) { return 2 * EARTH_RADIUS * std::asin(std::sqrt(std::clamp(key, 0.0f, 1.0f))); }
+};
+
 class QuadTree {
+    friend class NearestNeighborIterator;
+    friend struct QueueItem;
+
     static constexpr int CAPACITY = 4; // Max number of points before subdividing the node
-    Rect boundary; // The boundary this QuadTree node represents
-    std::array<Point, CAPACITY> points; // Array storing points within this node
-    int point_count = 0; // Current number of points in the node
-    bool divided = false; // Flag indicating if the node has been subdivided
+    static constexpr int MAX_DEPTH = 24; // Beyond this many halvings a float boundary can no longer separate points
+    static constexpr int DEFAULT_PREFETCH_DISTANCE = 2; // Enqueued children whose child groups are prefetched per KNN step
+
+    // Quadrant order of the four consecutive children of a divided node
+    enum Quadrant { NORTHEAST = 0, NORTHWEST = 1, SOUTHEAST = 2, SOUTHWEST = 3 };
+
+    // A node of the tree, stored by value in the node arena
+    struct Node {
+        Rect boundary; // The boundary this node represents
+        std::array<Point, CAPACITY> points; // Array storing points within this node
+        int point_count = 0; // Current number of points in the node
+        int firstChild = -1; // Arena index of the first of the four consecutive children, -1 for a leaf
+        int overflow = -1; // Index into overflowPoints for a leaf that reached MAX_DEPTH, -1 if none
+        int depth = 0; // Depth below the root this node was created under, bounds further subdivision
+        int parent = -1; // Arena index of the parent, -1 for the root and RELEASED for a released sibling group
+
+        // Summary of every point stored in this subtree, kept current by insert
+        int subtreeCount = 0;
+        float payloadMin = std::numeric_limits<float>::max();
+        float payloadMax = std::numeric_limits<float>::lowest();
+        double payloadSum = 0.0;
+
+        Node() = default;
+        explicit Node(const Rect &boundary, const int depth = 0) : boundary(boundary), depth(depth) {}
+
+        [[nodiscard]] bool divided() const { return firstChild >= 0; } // Check if this node is subdivided
+    };
+
+    using NodeArena = std::vector<Node, PageAllocator<Node>>;
+    NodeArena nodes; // Node arena; the root is nodes[0] and siblings are always adjacent
+    std::vector<std::vector<Point>> overflowPoints; // Points beyond CAPACITY in leaves that reached MAX_DEPTH
+    bool growable = false; // Grow the root instead of rejecting points outside it
+    int prefetchDistance = DEFAULT_PREFETCH_DISTANCE; // 0 disables software prefetching
+
+    static constexpr double NEVER = std::numeric_limits<double>::max(); // Timestamp of points that never expire
+    static constexpr int RELEASED = -2; // Parent of the nodes of a sibling group waiting in freeGroups
+
+    // Timestamps of a node's points and the oldest one in its subtree. They are kept beside the arena, and
+    // only once a timestamped point has been inserted, so trees without expiry keep their node size.
+    struct Stamps {
+        std::array<double, CAPACITY> points; // Slots past point_count hold NEVER
+        double oldest = NEVER;
+
+        Stamps() { points.fill(NEVER); }
+    };
+    std::vector<Stamps> stamps; // Parallel to nodes once timed
+    std::vector<std::vector<double>> overflowStamps; // Parallel to overflowPoints once timed
+    bool timed = false; // Set by the first timestamped insert
+    double visibleFrom = std::numeric_limits<double>::lowest(); // Queries returning points skip those stamped earlier
+    std::vector<int> freeGroups; // First indices of sibling groups released by expiry, reused by subdivide
+
+    [[nodiscard]] const Node *childrenOf(const Node &node) const { return &nodes[node.firstChild]; } // The four children of a divided node
+    [[nodiscard]] std::span<const Point> overflowOf(const Node &node) const; // Overflow points of a leaf, empty for most nodes
+
+    static Rect quadrantRect(const Rect &parent, int quadrant); // Boundary of one quadrant of parent
+
+    // Prefetch the cache lines of the sibling group a divided node points to; a no-op for leaves
+    void prefetchChildren(const Node &node) const;
+
+    // Quadrant of boundary holding point, from two comparisons against its centre (orthantOf in 2D). Points on
+    // the centre lines go east and north, the first child whose boundary contains them in NE, NW, SE, SW order.
+    static int quadrantOf(const Rect &boundary, const Point &point) {
+        return orthantOf<2>(boundary.centre(), point.coords());
+    }
+
+    // Iterative descent from nodes[index], whose boundary contains point; indices stay valid as the arena grows.
+    // Returns the index of the leaf that stored the point.
+    int insertFrom(int index, const Point &point, double stamp);
+
+    // Lowest node at or above nodes[handle] whose boundary contains point, climbing parent links; the root
+    // when the handle is unset or its node was released
+    [[nodiscard]] int climbFrom(int handle, const Point &point) const;
+
+    // Fold a point stored below nodes[index] into the summaries of every node above it
+    void addToAncestors(int index, const Point &point, double stamp);
+
+    // Recompute summaries and merge children from the parent of nodes[index] up to the root, after a removal
+    // below it. Returns the lowest node of that path still in the tree.
+    int repairAncestors(int index);
+
+    std::vector<Point> &overflowList(Node &node); // Overflow list of a leaf, created on first use
+
+    void enableTimestamps(); // Start the side arrays, stamping the points stored so far NEVER
+
+    // True if a query should skip slot of node (slots past point_count index its overflow list)
+    [[nodiscard]] bool hidden(const Node &node, int slot) const;
+    [[nodiscard]] bool hidingStale() const; // True while ignoreOlderThan hides points of a timed tree
+
+    struct ExpirySweep; // Cutoff, time budget and progress of one expireOlderThan call
+    void expire_rec(int index, ExpirySweep &sweep); // Drop stale points below nodes[index], then fix it up
+    // Remove point below nodes[index], reporting its stamp; exact also requires its payload to match
+    bool remove_rec(int index, const Point &point, bool exact, double &stamp);
+    bool moveMatching(const Point &from, const Point &to, bool exact); // Shared by move and moveExact
+    void summarize(int index); // Recompute a node's summary from its points and its children's summaries
+    void collapse(int index); // Pull four leaf children back into their parent once their points fit it
+
+    // Insert a batch lying inside nodes[index], partitioning it among the children that receive points
+    void insertBatchFrom(int index, std::span<Point> batch);
+
+    // KNN descent from nodes[start] into nearestHeap, pruning against maxDist and keeping both current; the
+    // heap may already hold candidates from an earlier search, and maxDist may start as a bound on the N-th key
+    template<typename Metric, size_t N, typename PointPredicate, typename NodePredicate>
+    void searchNearest(int start, const Point &target, float &maxDist, bool &targetSkipped,
+                       std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                       std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &accept, NodePredicate &mayContain) const;
+
+    void print_quadtree_rec(const Node &node, int depth) const; // Helper function to recursively print the tree
+
+    void subdivide(int index); // Subdivide nodes[index] into four child nodes appended to the arena
+
+    // Root boundary after one growth step toward point and the quadrant the old root becomes in it, or -1
+    // when the old root is not exactly a quadrant and the tree is rebuilt below the returned boundary
+    static Rect grownBoundary(const Rect &boundary, const Point &point, int &quadrant);
+    bool growToward(const Point &point); // Double the root toward point, keeping the old root as one quadrant
+    void rebuild(const Rect &boundary); // Reinsert every point, keeping its stamp, below a new root covering boundary
+
+    void aggregate_rec(const Node &node, const Rect &range, PayloadAggregate &result) const; // Helper accumulating aggregate()
 
-    // Child QuadTree nodes (subdivisions)
-    std::unique_ptr<QuadTree> northeast;
-    std::unique_ptr<QuadTree> northwest;
-    std::unique_ptr<QuadTree> southeast;
-    std::unique_ptr<QuadTree> southwest;
+    struct RasterBand; // Pixel grid geometry and the rows one worker writes
+    void rasterize_rec(const Node &node, const RasterBand &band) const; // Helper accumulating one band of rasterize()
 
+    // Dual-tree traversal emitting every pair (a in first, b in second) closer than sqrt(r2)
+    template<typename Callback>
+    void join_rec(const Node &first, const QuadTree &other, const Node &second, float r2, Callback &callback) const;
 
-    void print_quadtree_rec(int depth) const; // Helper function to recursively print the tree
+    // Blocked distance test between the points of two leaves
+    template<typename Callback>
+    void joinLeaves(const Node &first, const QuadTree &other, const Node &second, float r2, Callback &callback) const;
 
-    void subdivide(); // Subdivide the current node into four child nodes
+    // Self-join of one subtree, emitting each pair of its points closer than sqrt(r2) once
+    template<typename Callback>
+    void selfJoin_rec(const Node &node, float r2, Callback &callback) const;
+
+    // Parameter interval [tEnter, tExit] over which origin + t * dir (dir normalized) crosses box grown by tolerance
+    static bool clipRay(const Rect &box, const Point &origin, const Point &dir, float tolerance, float &tEnter, float &tExit);
+
+    // Front-to-back ray descent, shrinking hit.t as closer hits are found
+    void raycast_rec(const Node &node, const Point &origin, const Point &dir, float maxT, float tolerance, float tEnter, RayHit &hit, bool &found) const;
+
+    template<typename Visitor>
+    void querySegment_rec(const Node &node, const Point &origin, const Point &dir, float length, float tolerance, Visitor &visitor) const;
+
+    template<typename Visitor>
+    void visitAll(const Node &node, Visitor &visitor) const; // Emit every point of the subtree without testing it
+
+    template<typename Visitor>
+    void queryRange_rec(const Node &node, const Rect &range, Visitor &visitor) const;
+
+    // Crossing-number test; edges whose ends sit on opposite sides of p.y toggle the parity
+    static bool pointInPolygon(std::span<const Point> vertices, const Point &p);
+
+    // Polygon descent; edges[begin, end) are the polygon edges crossing the parent node
+    template<typename Visitor>
+    void queryPolygon_rec(const Node &node, std::span<const Point> vertices, std::vector<int> &edges, size_t begin, size_t end, Visitor &visitor) const;
+
+    // Runs body(i) for every i in [0, count) on up to `threads` workers (0 picks the hardware concurrency)
+    template<typename Body>
+    static void parallelFor(size_t count, unsigned threads, Body &&body);
 
 
 public:
     explicit QuadTree(const Rect &boundary); // Constructor initializing QuadTree with a boundary
 
-    [[nodiscard]] bool isDivided() const; // Check if this node is subdivided
+    // Constructor for a tree whose root doubles toward points falling outside it when growable is set.
+    // Each growth step re-parents the existing tree as one quadrant of the new root in O(1). That needs the
+    // old root to be exactly a quadrant of the doubled one, which holds once its centre and extents are multiples
+    // of a power of two; any other root is rebuilt once onto such a cover the first time it grows.
+    QuadTree(const Rect &boundary, bool growable);
+
+    [[nodiscard]] const Rect &getBoundary() const; // The boundary covered by the root
+
+    [[nodiscard]] bool isDivided() const; // Check if the root is subdivided
     static int capacity();
 
     void print_quadtree(int depth = 0) const; // Print the QuadTree structure
 
     bool insert(const Point &point); // Insert a point into the QuadTree
 
+    // Insert a batch of points in one pass, merging into whatever the tree already holds. Each node splits
+    // at most once for the whole batch and partitions it in place by quadrant, like a 4-way quicksort,
+    // so only children that receive points are descended. The batch is reordered; points outside a
+    // fixed root are moved behind the accepted ones and skipped. Returns the number of points inserted.
+    size_t insertBatch(std::span<Point> batch);
+
+    // Insert a point stamped with timestamp (any clock, e.g. seconds). Points inserted without a timestamp,
+    // through either insert or insertBatch, never expire.
+    bool insert(const Point &point, double timestamp);
+
+    // Remove points stamped before cutoff, spending at most budget on it. Subtrees whose oldest stamp is not
+    // before cutoff are skipped, nodes whose points fit their parent again are merged into it, and released
+    // nodes are reused by later inserts. The sweep restarts from the root on every call but only re-enters
+    // subtrees that still hold stale points, so repeated calls make steady progress. removed reports how many
+    // points were dropped; returns true once no point older than cutoff is left.
+    bool expireOlderThan(double cutoff, std::chrono::microseconds budget, size_t &removed);
+
+    // Make every query that returns points skip those stamped before cutoff even if they have not been swept
+    // yet; lowest() turns it off. Summaries used by aggregate and rasterize still count them until swept.
+    void ignoreOlderThan(double cutoff);
+
+    // Remove one stored point with the coordinates of point. Summaries on its path are recomputed and
+    // nodes whose points fit their parent again are merged into it, as in expireOlderThan. False if absent.
+    bool remove(const Point &point);
+
+    // Remove the point at from and insert to in its place, keeping its timestamp. False, leaving the tree
+    // unchanged, if from is not stored or to lies outside a fixed root.
+    bool move(const Point &from, const Point &to);
+
+    // remove and move that also require the stored point's payload to equal the given one, for callers that
+    // must pick out one of several points at the same coordinates
+    bool removeExact(const Point &point);
+    bool moveExact(const Point &from, const Point &to);
+
+    // True if insert would store point: it lies inside the root, or a growable root can grow out to it
+    [[nodiscard]] bool accepts(const Point &point) const;
+
+    // Arena position of a leaf, kept by the caller next to an entity so local operations on it start there
+    // and climb parent links only as far as they need instead of descending from the root. Handles are
+    // hints, checked on use: one whose node was split, merged away or renumbered by optimize() only costs
+    // a longer climb, up to a descent from the root, never a wrong result.
+    struct LeafHandle {
+        int node = -1; // -1 starts from the root
+    };
+
+    // Handle of the leaf holding point, or where it would be stored; false if point is outside the root
+    bool locate(const Point &point, LeafHandle &leaf) const;
+
+    // Insert point starting from the leaf of a nearby entity, or the root for an unset handle, and point
+    // leaf at the leaf that stored it
+    bool insert(const Point &point, LeafHandle &leaf);
+
+    // remove and move starting from the leaf holding from; move points leaf at the leaf now storing to
+    bool remove(const Point &point, const LeafHandle &leaf);
+    bool move(const Point &from, const Point &to, LeafHandle &leaf);
+
+    // Boundary of the leaf holding point, or where it would be stored; false if point is outside the root
+    bool locate(const Point &point, Rect &leaf) const;
+
+    // Software prefetching for KNN and insert. Each KNN step prefetches the child groups of the `distance`
+    // nearest children it enqueues, so their loads overlap the work on the nodes popped before them;
+    // insert prefetches the next level of its descent. 0 disables prefetching.
+    void setPrefetchDistance(int distance);
+    [[nodiscard]] int getPrefetchDistance() const;
+
+    // Back the node arena, where leaf points are stored too, with memory following policy, e.g. huge pages
+    // to cut TLB misses on trees spanning gigabytes. The arena is copied once into the new memory; setting
+    // the policy before filling the tree avoids that. The policy stays in effect as the arena grows.
+    void setMemoryPolicy(const MemoryPolicy &policy);
+    [[nodiscard]] MemoryPolicy getMemoryPolicy() const;
+
+    // Rewrite the node arena in van Emde Boas order over sibling groups, so subtrees that are visited
+    // together share cache lines and pages. Query results are unchanged; later inserts append as usual.
+    void optimize();
+
+    // Count, sum, min and max of the payloads inside range; subtrees fully inside it answer from their summary
+    [[nodiscard]] PayloadAggregate aggregate(const Rect &range) const;
+
+    // Point density of view on a width x height pixel grid, written row-major (row 0 at the top edge) to output.
+    // Nodes wholly inside one pixel or smaller than a pixel add their subtree count without being descended,
+    // so the cost follows the pixel count rather than the point count. Bands of rows are filled in parallel
+    // by `threads` workers (0 picks the hardware concurrency). Returns false if the grid does not fit output.
+    bool rasterize(const Rect &view, int width, int height, std::span<std::uint32_t> output, unsigned threads = 0) const;
+
+    // First point within tolerance of the ray origin + t * dir, 0 <= t <= maxT, ordered by its projection t.
+    // dir need not be normalized; t is measured in world units. Nodes are entered front to back along the
+    // ray and only those whose boundary (grown by tolerance) the ray crosses are visited, stopping once no
+    // node ahead can hold an earlier hit. Returns false if nothing is hit.
+    bool raycast(const Point &origin, const Point &dir, float maxT, float tolerance, RayHit &hit) const;
+
+    // Visit every point inside range (edges included); subtrees wholly inside it are emitted untested
+    template<typename Visitor>
+    void queryRange(const Rect &range, Visitor &&visitor) const;
+
+    // Visit every point within tolerance of the segment from a to b
+    template<typename Visitor>
+    void querySegment(const Point &a, const Point &b, float tolerance, Visitor &&visitor) const;
+
+    // Visit every point inside the polygon given by its vertices (closed implicitly, any winding).
+    // Nodes crossed by no polygon edge are wholly inside or outside and are classified by their centre;
+    // inside nodes are emitted without per-point tests and only straddling leaves test their points.
+    template<typename Visitor>
+    void queryPolygon(std::span<const Point> vertices, Visitor &&visitor) const;
+
+    // Spatial join: calls callback(a, b) for every a in this tree and b in other with distance(a, b) < r.
+    // Node pairs whose boundaries are farther apart than r are pruned, leaf pairs are tested in blocks.
+    // Pairs of top-level children are spread over `threads` workers (0 picks the hardware concurrency),
+    // in which case callback is invoked concurrently and must be thread-safe.
+    template<typename Callback>
+    void joinWithin(const QuadTree &other, float r, Callback &&callback, unsigned threads = 1) const;
+
+    // Self-join: calls callback(a, b) exactly once for every unordered pair of points with distance(a, b) < d.
+    // Siblings are only joined across boundaries that lie within d of each other; the subtrees and sibling
+    // pairs under the root are spread over `threads` workers with the same thread-safety caveat as joinWithin.
+    template<typename Callback>
+    void forEachPairWithin(float d, Callback &&callback, unsigned threads = 1) const;
+
+    // Nearest neighbor search under a distance policy such as ManhattanMetric or HaversineMetric; nodes are
+    // pruned by Metric::lowerBound and maxDist reports the N-th neighbour's Metric::key. Returns the number
+    // of neighbours found, which is less than N only when the tree holds fewer candidates.
+    template<typename Metric, size_t N, typename PointPredicate, typename NodePredicate>
+    size_t nearestNeighborsBy(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                              std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                              std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &&accept,
+                              NodePredicate &&mayContain) const;
+
+    template<typename Metric, size_t N>
+    void nearestNeighborsBy(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                            std::vector<std::pair<float, Point>> &nearestHeap) const;
+
+    // The N nearest points to target, nearest first, with the SpatialIndex contract shared with
+    // ShardedQuadTree and UniformGridIndex. Returns the number of points found.
+    template<size_t N>
+    size_t nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const;
+
+    // Same result, warm-started for a target that moved a little since an earlier query returned previous,
+    // e.g. last frame's neighbours of a player. The farthest of previous from target bounds the N-th
+    // neighbour's distance, so the descent prunes against it from the root instead of starting unbounded.
+    // previous may hold stale points: a result not inside the bound is redone as a cold search.
+    template<size_t N>
+    size_t nearestNeighborsSeeded(const Point &target, std::span<const Point> previous, std::array<Point, N> &nearest) const;
+
+    // Same result, starting from the leaf of an entity at or near target: the leaf's subtree is searched
+    // first, then the siblings of each ancestor in turn, stopping at the first ancestor whose boundary holds
+    // the ball around target out to the N-th neighbour. Around an entity's own position that is usually
+    // reached within a level or two, without descending from the root.
+    template<size_t N>
+    size_t nearestNeighbors(const Point &target, const LeafHandle &leaf, std::array<Point, N> &nearest) const;
+
+    // Offer this tree's points to a KNN heap shared with other trees, as a grid of trees does: nearestHeap
+    // holds at most N (squared distance, point) pairs and is a max-heap once full, when maxDist is its front.
+    // Subtrees farther than maxDist are pruned and targetSkipped carries the skip-the-target-once rule across.
+    template<size_t N>
+    void gatherNearest(const Point &target, float &maxDist, bool &targetSkipped,
+                       std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                       std::vector<std::pair<float, Point>> &nearestHeap) const;
+
     // Nearest neighbor search function with preallocated memory
     template<size_t N>
     void nearestNeighbors(const Point &target, std::array<Point, N> &nearest, float &maxDist,
                           std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
                           std::vector<std::pair<float, Point>> &nearestHeap) const;
+
+    // Nearest neighbor search restricted to points accepted by `accept(const Point&)`.
+    // The predicate is evaluated before heap insertion, so rare matches do not require over-fetching.
+    template<size_t N, typename PointPredicate>
+    void nearestNeighbors(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                          std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                          std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &&accept) const;
+
+    // Same as above, with `mayContain(float payloadMin, float payloadMax)` deciding from a subtree's
+    // payload range whether it can hold any accepted point; subtrees for which it returns false are pruned.
+    template<size_t N, typename PointPredicate, typename NodePredicate>
+    void nearestNeighbors(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                          std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                          std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &&accept,
+                          NodePredicate &&mayContain) const;
 };
+
 struct QueueItem {
-    const QuadTree* node;
+    const QuadTree::Node* node;
     float distance;
+    int index = -1; // Index of a point stored in `node`, or -1 when the item stands for the node itself
 
-    QueueItem(const QuadTree* n, const float d) : node(n), distance(d) {}
+    QueueItem(const QuadTree::Node* n, const float d) : node(n), distance(d) {}
+    QueueItem(const QuadTree::Node* n, const float d, const int i) : node(n), distance(d), index(i) {}
 
     bool operator>(const QueueItem& other) const {
         return distance > other.distance;
     }
 };
+
+// Incremental nearest neighbor search: yields the points of a QuadTree one at a time in increasing
+// distance from the target, so callers that stop early never pay for a large-k query.
+// Nodes and points share one priority queue; the tree must not be modified while iterating.
+class NearestNeighborIterator {
+    const QuadTree *tree;
+    Point target;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+
+public:
+    NearestNeighborIterator(const QuadTree &tree, const Point &target);
+
+    bool next(Point &point); // Fetch the next nearest point, false once the tree is exhausted
+    bool next(Point &point, float &distSq); // Same, also reporting the squared distance to the target
+};
 #include "QuadTree.tpp"
 
 #endif //QUADTREE_H
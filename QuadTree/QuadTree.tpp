@@ -6,81 +6,593 @@
 #include <algorithm>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+inline void QuadTree::prefetchChildren(const Node &node) const {
+    if (!node.divided()) return;
+    const char *group = reinterpret_cast<const char *>(&nodes[node.firstChild]);
+    for (size_t offset = 0; offset < 4 * sizeof(Node); offset += 64) {
+        __builtin_prefetch(group + offset, 0, 3);
+    }
+}
+
+inline bool QuadTree::hidden(const Node &node, const int slot) const {
+    const size_t index = static_cast<size_t>(&node - nodes.data());
+    const double stamp = slot < node.point_count ? stamps[index].points[slot]
+                                                 : overflowStamps[node.overflow][static_cast<size_t>(slot - node.point_count)];
+    return stamp < visibleFrom;
+}
+
+inline bool QuadTree::hidingStale() const {
+    return timed && visibleFrom > std::numeric_limits<double>::lowest();
+}
 
 // Optimized nearest neighbor search in QuadTree
 template<size_t N>
 void QuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest, float &maxDist,
                                 std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>& nodeQueue,
                                 std::vector<std::pair<float, Point>> &nearestHeap) const {
+    nearestNeighbors<N>(target, nearest, maxDist, nodeQueue, nearestHeap,
+                        [](const Point &) { return true; },
+                        [](float, float) { return true; });
+}
+
+// Nearest neighbor search keeping only the points accepted by the predicate
+template<size_t N, typename PointPredicate>
+void QuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                                std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>& nodeQueue,
+                                std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &&accept) const {
+    nearestNeighbors<N>(target, nearest, maxDist, nodeQueue, nearestHeap, accept,
+                        [](float, float) { return true; });
+}
+
+// Filtered nearest neighbor search, pruning subtrees whose payload range cannot match
+template<size_t N, typename PointPredicate, typename NodePredicate>
+void QuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                                std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>& nodeQueue,
+                                std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &&accept,
+                                NodePredicate &&mayContain) const {
+    nearestNeighborsBy<EuclideanMetric, N>(target, nearest, maxDist, nodeQueue, nearestHeap, accept, mayContain);
+}
+
+template<typename Metric, size_t N>
+void QuadTree::nearestNeighborsBy(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                                  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>& nodeQueue,
+                                  std::vector<std::pair<float, Point>> &nearestHeap) const {
+    nearestNeighborsBy<Metric, N>(target, nearest, maxDist, nodeQueue, nearestHeap,
+                                  [](const Point &) { return true; },
+                                  [](float, float) { return true; });
+}
 
-    nodeQueue.emplace(this, 0.0f);
+// Nearest neighbor search under a distance policy; every other variant forwards here
+template<typename Metric, size_t N, typename PointPredicate, typename NodePredicate>
+size_t QuadTree::nearestNeighborsBy(const Point &target, std::array<Point, N> &nearest, float &maxDist,
+                                    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>& nodeQueue,
+                                    std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &&accept,
+                                    NodePredicate &&mayContain) const {
+    while (!nodeQueue.empty()) nodeQueue.pop(); // Entries left by an earlier search may point into a reallocated arena
+    maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false; // The query point itself is skipped once if it is stored in the tree
+    searchNearest<Metric, N>(0, target, maxDist, targetSkipped, nodeQueue, nearestHeap, accept, mayContain);
+    return drainNearest(nearestHeap, nearest); // Populate the nearest array
+}
+
+template<size_t N>
+void QuadTree::gatherNearest(const Point &target, float &maxDist, bool &targetSkipped,
+                             std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> &nodeQueue,
+                             std::vector<std::pair<float, Point>> &nearestHeap) const {
+    while (!nodeQueue.empty()) nodeQueue.pop(); // An earlier search may have stopped with entries left
+    auto acceptAll = [](const Point &) { return true; };
+    auto mayContainAny = [](float, float) { return true; };
+    searchNearest<EuclideanMetric, N>(0, target, maxDist, targetSkipped, nodeQueue, nearestHeap, acceptAll, mayContainAny);
+}
+
+// Best-first descent feeding the bounded max-heap of the N closest points, which may already hold candidates
+template<typename Metric, size_t N, typename PointPredicate, typename NodePredicate>
+void QuadTree::searchNearest(const int start, const Point &target, float &maxDist, bool &targetSkipped,
+                             std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>& nodeQueue,
+                             std::vector<std::pair<float, Point>> &nearestHeap, PointPredicate &accept,
+                             NodePredicate &mayContain) const {
+    // Offer a candidate to the bounded max-heap of the N closest points
+    auto consider = [&](const Point &candidate) {
+        if (!targetSkipped && candidate == target) {
+            targetSkipped = true;
+            return;
+        }
+        if (!accept(candidate)) return; // Filter before the candidate ever reaches the heap
+
+        offerNearest<N>(nearestHeap, Metric::key(target, candidate), candidate, maxDist);
+    };
+
+    const Node &root = nodes[start];
+    if (root.subtreeCount > 0 && mayContain(root.payloadMin, root.payloadMax)) {
+        nodeQueue.emplace(&root, 0.0f);
+    }
+    const bool hiding = hidingStale(); // Skip stale points not yet swept
     while (!nodeQueue.empty()) {
-        const QuadTree* current = nodeQueue.top().node;
+        const Node* current = nodeQueue.top().node;
         const float currentDistance = nodeQueue.top().distance;
         nodeQueue.pop();
 
-        // Stop if current distance is larger than the farthest point in nearestHeap
-        if (nearestHeap.size() == N && currentDistance > maxDist) {
+        // Stop if current distance is larger than the farthest point in nearestHeap, or than a seeded bound
+        if (currentDistance > maxDist) {
             break;  // Early exit
         }
 
         // Check all points in the current node
-        for (int i = 0; i < current->point_count; ++i) {
-            const Point& candidate = current->points[i];
-            if (candidate == target) continue;
-
-            float dist = distanceSquared(target, candidate);
-
-            // Add to heap if we haven't found N points yet
-            if (nearestHeap.size() < N) {
-                nearestHeap.emplace_back(dist, candidate);
-                if (nearestHeap.size() == N) {
-                    std::ranges::make_heap(nearestHeap.begin(), nearestHeap.end()); // Build heap
-                    maxDist = nearestHeap.front().first; // Update maxDist after heap is filled
-                }
+        const std::span<const Point> overflow = overflowOf(*current);
+        if (hiding) {
+            for (int i = 0; i < current->point_count; ++i) {
+                if (!hidden(*current, i)) consider(current->points[i]);
+            }
+            for (size_t i = 0; i < overflow.size(); ++i) {
+                if (!hidden(*current, current->point_count + static_cast<int>(i))) consider(overflow[i]);
+            }
+        } else {
+            for (int i = 0; i < current->point_count; ++i) {
+                consider(current->points[i]);
             }
-            // Otherwise, only replace if the new point is closer
-            else if (dist < nearestHeap.front().first) {
-                std::ranges::pop_heap(nearestHeap.begin(), nearestHeap.end());
-                nearestHeap.back() = std::make_pair(dist, candidate);
-                std::ranges::push_heap(nearestHeap.begin(), nearestHeap.end());
-                maxDist = nearestHeap.front().first; // Update maxDist
+            for (const Point &candidate : overflow) {
+                consider(candidate);
             }
         }
 
         // Traverse the child nodes
-        if (current->divided) {
-            for (const QuadTree* child : { current->northeast.get(), current->northwest.get(), current->southeast.get(), current->southwest.get() }) {
-                if (!child) continue;
+        if (current->divided()) {
+            const Node *children = childrenOf(*current);
+            std::array<std::pair<float, const Node*>, 4> enqueued; // Children pushed this step, for prefetching
+            int count = 0;
+            for (int q = 0; q < 4; ++q) {
+                const Node *child = &children[q];
+                // Skip empty subtrees and those whose payload range cannot satisfy the filter
+                if (child->subtreeCount == 0 || !mayContain(child->payloadMin, child->payloadMax)) continue;
 
                 // Calculate the minimum distance from the target to the boundary of the child node
-                float dx = std::max(0.0f, std::abs(target.x - child->boundary.x) - child->boundary.w);
-                float dy = std::max(0.0f, std::abs(target.y - child->boundary.y) - child->boundary.h);
-                float minDist = dx * dx + dy * dy;
-
-                // Only traverse if minDist is smaller than maxDist, or we haven't found enough neighbors
-                if (minDist <= maxDist || nearestHeap.size() < N) {
-                    // Use the array of representative points to prune further
-                    for (const auto& rep : child->points) {
-                        float repDist = distanceSquared(target, rep);
-
-                        // Check if representative point is within maxDist, and if so, enqueue the child
-                        if (repDist < maxDist) {
-                            nodeQueue.emplace(child, minDist);  // Enqueue child node for further exploration
-                            break; // If one rep point qualifies, no need to check others
-                        }
-                    }
+                const float minDist = Metric::lowerBound(target, child->boundary);
+
+                // Only traverse if minDist is smaller than maxDist, which stays unbounded until N neighbors are found
+                if (minDist <= maxDist) {
+                    nodeQueue.emplace(child, minDist);  // Enqueue child node for further exploration
+                    int slot = count++; // Keep enqueued ordered by distance
+                    for (; slot > 0 && enqueued[slot - 1].first > minDist; --slot) enqueued[slot] = enqueued[slot - 1];
+                    enqueued[slot] = {minDist, child};
                 }
             }
+
+            // Start loading the child groups of the nearest children just enqueued, the ones popped soonest,
+            // so the loads overlap the work on the nodes popped before them
+            const int ahead = std::min(count, prefetchDistance);
+            for (int i = 0; i < ahead; ++i) {
+                prefetchChildren(*enqueued[i].second);
+            }
+        }
+    }
+}
+
+// Reuses one node queue and heap per thread, and puts the result into nearest-first order
+template<size_t N>
+size_t QuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const {
+    thread_local std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    thread_local std::vector<std::pair<float, Point>> nearestHeap;
+    while (!nodeQueue.empty()) nodeQueue.pop();
+    nearestHeap.clear();
+
+    float maxDist;
+    const size_t found = nearestNeighborsBy<EuclideanMetric, N>(target, nearest, maxDist, nodeQueue, nearestHeap,
+                                                                [](const Point &) { return true; },
+                                                                [](float, float) { return true; });
+    const auto end = nearest.begin() + static_cast<std::ptrdiff_t>(found);
+    if (found == N) {
+        std::reverse(nearest.begin(), end);
+    } else {
+        // Fewer than N candidates never formed a heap and come out in discovery order
+        std::sort(nearest.begin(), end, [&](const Point &a, const Point &b) { return distanceSquared(target, a) < distanceSquared(target, b); });
+    }
+    return found;
+}
+
+// Seeds maxDist with the bound and verifies the result against it; a stale seed only costs a second search
+template<size_t N>
+size_t QuadTree::nearestNeighborsSeeded(const Point &target, const std::span<const Point> previous, std::array<Point, N> &nearest) const {
+    if (previous.size() < N) return nearestNeighbors<N>(target, nearest); // Too few points to bound the N-th
+
+    float bound = 0.0f;
+    for (const Point &p : previous) bound = std::max(bound, distanceSquared(target, p));
+
+    thread_local std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    thread_local std::vector<std::pair<float, Point>> nearestHeap;
+    while (!nodeQueue.empty()) nodeQueue.pop();
+    nearestHeap.clear();
+
+    float maxDist = bound;
+    bool targetSkipped = false;
+    auto acceptAll = [](const Point &) { return true; };
+    auto mayContainAny = [](float, float) { return true; };
+    searchNearest<EuclideanMetric, N>(0, target, maxDist, targetSkipped, nodeQueue, nearestHeap, acceptAll, mayContainAny);
+
+    // Points beyond the bound may have been passed over in pruned nodes, so only N results within it are exact
+    if (nearestHeap.size() < N || nearestHeap.front().first > bound) return nearestNeighbors<N>(target, nearest);
+
+    std::ranges::sort_heap(nearestHeap.begin(), nearestHeap.end());
+    for (size_t i = 0; i < N; ++i) {
+        nearest[i] = nearestHeap[i].second;
+    }
+    return N;
+}
+
+// Widens the searched area one ancestor at a time, each step adding the subtrees of the siblings just left
+template<size_t N>
+size_t QuadTree::nearestNeighbors(const Point &target, const LeafHandle &leaf, std::array<Point, N> &nearest) const {
+    thread_local std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    thread_local std::vector<std::pair<float, Point>> nearestHeap;
+    nearestHeap.clear();
+    float maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false;
+    auto acceptAll = [](const Point &) { return true; };
+    auto mayContainAny = [](float, float) { return true; };
+    auto search = [&](const int start) {
+        while (!nodeQueue.empty()) nodeQueue.pop(); // The previous subtree may have stopped with entries left
+        searchNearest<EuclideanMetric, N>(start, target, maxDist, targetSkipped, nodeQueue, nearestHeap, acceptAll, mayContainAny);
+    };
+
+    // Every point within sqrt(maxDist) of target lies in a node whose boundary holds that whole ball
+    auto holdsBall = [&](const Rect &r) {
+        const float margin = std::min(std::min(target.x - (r.x - r.w), (r.x + r.w) - target.x),
+                                      std::min(target.y - (r.y - r.h), (r.y + r.h) - target.y));
+        return margin > 0.0f && margin * margin > maxDist;
+    };
+
+    int index = climbFrom(leaf.node, target);
+    search(index);
+    while (index != 0 && !(nearestHeap.size() == N && holdsBall(nodes[index].boundary))) {
+        const int parent = nodes[index].parent;
+        const int first = nodes[parent].firstChild;
+        for (int q = 0; q < 4; ++q) {
+            const int sibling = first + q;
+            if (sibling == index || nodes[sibling].subtreeCount == 0) continue;
+            if (nearestHeap.size() == N && distanceSquared(target, nodes[sibling].boundary) > maxDist) continue;
+            search(sibling);
+        }
+        index = parent;
+    }
+
+    std::sort(nearestHeap.begin(), nearestHeap.end()); // A heap only once N candidates were found
+    for (size_t i = 0; i < nearestHeap.size(); ++i) {
+        nearest[i] = nearestHeap[i].second;
+    }
+    return nearestHeap.size();
+}
+
+template<typename Visitor>
+void QuadTree::queryRange(const Rect &range, Visitor &&visitor) const {
+    queryRange_rec(nodes[0], range, visitor);
+}
+
+template<typename Visitor>
+void QuadTree::queryRange_rec(const Node &node, const Rect &range, Visitor &visitor) const {
+    if (node.subtreeCount == 0 || !node.boundary.intersects(range)) return;
+    if (range.contains(node.boundary)) {
+        visitAll(node, visitor);
+        return;
+    }
+
+    const bool hiding = hidingStale();
+    for (int i = 0; i < node.point_count; ++i) {
+        if (range.contains(node.points[i]) && !(hiding && hidden(node, i))) visitor(node.points[i]);
+    }
+    const std::span<const Point> overflow = overflowOf(node);
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        if (range.contains(overflow[i]) && !(hiding && hidden(node, node.point_count + static_cast<int>(i)))) visitor(overflow[i]);
+    }
+    if (node.divided()) {
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) queryRange_rec(children[q], range, visitor);
+    }
+}
+
+// Visits the points near a segment, descending only into nodes the segment's slab crosses
+template<typename Visitor>
+void QuadTree::querySegment(const Point &a, const Point &b, const float tolerance, Visitor &&visitor) const {
+    const float dx = b.x - a.x;
+    const float dy = b.y - a.y;
+    const float length = std::sqrt(dx * dx + dy * dy);
+    const Point dir = length > 0.0f ? Point(dx / length, dy / length) : Point(1.0f, 0.0f); // Degenerate segment: a disc around a
+    querySegment_rec(nodes[0], a, dir, length, tolerance, visitor);
+}
+
+template<typename Visitor>
+void QuadTree::querySegment_rec(const Node &node, const Point &origin, const Point &dir, const float length, const float tolerance, Visitor &visitor) const {
+    float tEnter, tExit;
+    if (node.subtreeCount == 0 || !clipRay(node.boundary, origin, dir, tolerance, tEnter, tExit) || tExit < 0.0f || tEnter > length) return;
+
+    const float tolerance2 = tolerance * tolerance;
+    auto test = [&](const Point &p) {
+        const float ox = p.x - origin.x;
+        const float oy = p.y - origin.y;
+        const float t = std::clamp(ox * dir.x + oy * dir.y, 0.0f, length); // Closest point on the segment
+        const float ex = ox - t * dir.x;
+        const float ey = oy - t * dir.y;
+        if (ex * ex + ey * ey <= tolerance2) visitor(p);
+    };
+    const bool hiding = hidingStale();
+    for (int i = 0; i < node.point_count; ++i) {
+        if (!(hiding && hidden(node, i))) test(node.points[i]);
+    }
+    const std::span<const Point> overflow = overflowOf(node);
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        if (!(hiding && hidden(node, node.point_count + static_cast<int>(i)))) test(overflow[i]);
+    }
+
+    if (node.divided()) {
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) querySegment_rec(children[q], origin, dir, length, tolerance, visitor);
+    }
+}
+
+template<typename Visitor>
+void QuadTree::visitAll(const Node &node, Visitor &visitor) const {
+    if (node.subtreeCount == 0) return;
+    const bool hiding = hidingStale();
+    for (int i = 0; i < node.point_count; ++i) {
+        if (!(hiding && hidden(node, i))) visitor(node.points[i]);
+    }
+    const std::span<const Point> overflow = overflowOf(node);
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        if (!(hiding && hidden(node, node.point_count + static_cast<int>(i)))) visitor(overflow[i]);
+    }
+    if (node.divided()) {
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) visitAll(children[q], visitor);
+    }
+}
+
+// Polygon query narrowing the set of edges that cross each node on the way down
+template<typename Visitor>
+void QuadTree::queryPolygon(std::span<const Point> vertices, Visitor &&visitor) const {
+    if (vertices.size() < 3) return;
+
+    std::vector<int> edges(vertices.size()); // Stack of crossing edge lists, one segment per level
+    for (size_t i = 0; i < vertices.size(); ++i) edges[i] = static_cast<int>(i);
+    queryPolygon_rec(nodes[0], vertices, edges, 0, edges.size(), visitor);
+}
+
+template<typename Visitor>
+void QuadTree::queryPolygon_rec(const Node &node, std::span<const Point> vertices, std::vector<int> &edges, const size_t begin, const size_t end, Visitor &visitor) const {
+    if (node.subtreeCount == 0) return;
+
+    // Keep the edges of the parent's list that also cross this node; no other edge can
+    const size_t mark = edges.size();
+    for (size_t k = begin; k < end; ++k) {
+        const int e = edges[k];
+        const Point &a = vertices[e];
+        const Point &b = vertices[(static_cast<size_t>(e) + 1) % vertices.size()];
+        float tEnter, tExit;
+        if (clipRay(node.boundary, a, Point(b.x - a.x, b.y - a.y), 0.0f, tEnter, tExit) && tExit >= 0.0f && tEnter <= 1.0f) {
+            edges.push_back(e);
+        }
+    }
+
+    if (edges.size() == mark) {
+        // No edge crosses the node, so all of it lies on the same side as its centre
+        if (pointInPolygon(vertices, Point(node.boundary.x, node.boundary.y))) visitAll(node, visitor);
+    } else if (node.divided()) {
+        const size_t crossingEnd = edges.size();
+        const Node *children = childrenOf(node);
+        for (int q = 0; q < 4; ++q) queryPolygon_rec(children[q], vertices, edges, mark, crossingEnd, visitor);
+    } else {
+        // Straddling leaf: edge-major crossing test over fixed-width lanes so the inner loop vectorizes
+        std::array<float, CAPACITY> xs{}, ys{};
+        std::array<bool, CAPACITY> inside{};
+        for (int j = 0; j < node.point_count; ++j) {
+            xs[j] = node.points[j].x;
+            ys[j] = node.points[j].y;
+        }
+        for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+            const Point &a = vertices[j];
+            const Point &b = vertices[i];
+            for (int lane = 0; lane < CAPACITY; ++lane) {
+                const float side = (xs[lane] - a.x) * (b.y - a.y) - (b.x - a.x) * (ys[lane] - a.y);
+                inside[lane] ^= (a.y > ys[lane]) != (b.y > ys[lane]) && (side < 0.0f) == (b.y > a.y);
+            }
+        }
+        const bool hiding = hidingStale();
+        for (int j = 0; j < node.point_count; ++j) {
+            if (inside[j] && !(hiding && hidden(node, j))) visitor(node.points[j]);
+        }
+        const std::span<const Point> overflow = overflowOf(node);
+        for (size_t j = 0; j < overflow.size(); ++j) {
+            if (pointInPolygon(vertices, overflow[j]) && !(hiding && hidden(node, node.point_count + static_cast<int>(j)))) visitor(overflow[j]);
+        }
+    }
+    edges.resize(mark);
+}
+
+// Spatial join between two trees, parallel over pairs of top-level children
+template<typename Callback>
+void QuadTree::joinWithin(const QuadTree &other, const float r, Callback &&callback, const unsigned threads) const {
+    const float r2 = r * r;
+
+    // Split the root pair into pairs of top-level children so they can be handed to separate workers
+    std::vector<std::pair<const Node*, const Node*>> tasks;
+    auto topLevel = [](const QuadTree &tree) {
+        const Node &root = tree.nodes[0];
+        if (!root.divided()) return std::vector<const Node*>{ &root };
+        const Node *children = tree.childrenOf(root);
+        return std::vector<const Node*>{ &children[0], &children[1], &children[2], &children[3] };
+    };
+    for (const Node* first : topLevel(*this)) {
+        for (const Node* second : topLevel(other)) {
+            tasks.emplace_back(first, second);
         }
     }
 
-    // Populate the nearest array
-    for (unsigned int i = 0; i < N && !nearestHeap.empty(); ++i) {
-        std::ranges::pop_heap(nearestHeap.begin(), nearestHeap.end());
-        nearest[i] = nearestHeap.back().second;
-        nearestHeap.pop_back();
+    parallelFor(tasks.size(), threads, [&](const size_t i) {
+        join_rec(*tasks[i].first, other, *tasks[i].second, r2, callback);
+    });
+}
+
+template<typename Callback>
+void QuadTree::join_rec(const Node &first, const QuadTree &other, const Node &second, const float r2, Callback &callback) const {
+    // Prune pairs that are empty or whose boundaries are too far apart to hold a matching pair
+    if (first.subtreeCount == 0 || second.subtreeCount == 0) return;
+    if (distanceSquared(first.boundary, second.boundary) >= r2) return;
+
+    if (!first.divided() && !second.divided()) {
+        joinLeaves(first, other, second, r2, callback);
+    }
+    // Split the larger of the two nodes so both sides shrink at the same pace
+    else if (first.divided() && (!second.divided() || first.boundary.w >= second.boundary.w)) {
+        const Node *children = childrenOf(first);
+        for (int q = 0; q < 4; ++q) join_rec(children[q], other, second, r2, callback);
+    } else {
+        const Node *children = other.childrenOf(second);
+        for (int q = 0; q < 4; ++q) join_rec(first, other, children[q], r2, callback);
     }
 }
 
+template<typename Callback>
+void QuadTree::joinLeaves(const Node &first, const QuadTree &other, const Node &second, const float r2, Callback &callback) const {
+    // Transpose the second leaf into fixed-width coordinate lanes so the distance loop vectorizes
+    std::array<float, CAPACITY> xs{}, ys{};
+    std::array<bool, CAPACITY> shown{}; // Lanes holding a point not hidden by the other tree's ignoreOlderThan
+    const bool secondHiding = other.hidingStale();
+    for (int j = 0; j < second.point_count; ++j) {
+        xs[j] = second.points[j].x;
+        ys[j] = second.points[j].y;
+        shown[j] = !(secondHiding && other.hidden(second, j));
+    }
+    const std::span<const Point> secondOverflow = other.overflowOf(second);
+
+    auto testBlock = [&](const Point &a) {
+        std::array<bool, CAPACITY> within{};
+        for (int j = 0; j < CAPACITY; ++j) {
+            const float dx = a.x - xs[j];
+            const float dy = a.y - ys[j];
+            within[j] = dx * dx + dy * dy < r2;
+        }
+        for (int j = 0; j < second.point_count; ++j) {
+            if (within[j] && shown[j]) callback(a, second.points[j]);
+        }
+        for (size_t j = 0; j < secondOverflow.size(); ++j) {
+            if (distanceSquared(a, secondOverflow[j]) < r2 && !(secondHiding && other.hidden(second, second.point_count + static_cast<int>(j)))) {
+                callback(a, secondOverflow[j]);
+            }
+        }
+    };
+
+    const bool firstHiding = hidingStale();
+    for (int i = 0; i < first.point_count; ++i) {
+        if (!(firstHiding && hidden(first, i))) testBlock(first.points[i]);
+    }
+    const std::span<const Point> firstOverflow = overflowOf(first);
+    for (size_t i = 0; i < firstOverflow.size(); ++i) {
+        if (!(firstHiding && hidden(first, first.point_count + static_cast<int>(i)))) testBlock(firstOverflow[i]);
+    }
+}
+
+// Self-join within one tree, parallel over the root's subtrees and sibling pairs
+template<typename Callback>
+void QuadTree::forEachPairWithin(const float d, Callback &&callback, const unsigned threads) const {
+    const float r2 = d * d;
+
+    // A task joins first with second, or first with itself when both are the same node
+    std::vector<std::pair<const Node*, const Node*>> tasks;
+    const Node &root = nodes[0];
+    if (root.divided()) {
+        const Node *quadrants = childrenOf(root);
+        for (int i = 0; i < 4; ++i) {
+            for (int j = i; j < 4; ++j) {
+                tasks.emplace_back(&quadrants[i], &quadrants[j]);
+            }
+        }
+    } else {
+        tasks.emplace_back(&root, &root);
+    }
+
+    parallelFor(tasks.size(), threads, [&](const size_t i) {
+        if (tasks[i].first == tasks[i].second) {
+            selfJoin_rec(*tasks[i].first, r2, callback);
+        } else {
+            join_rec(*tasks[i].first, *this, *tasks[i].second, r2, callback);
+        }
+    });
+}
+
+template<typename Callback>
+void QuadTree::selfJoin_rec(const Node &node, const float r2, Callback &callback) const {
+    if (node.subtreeCount < 2) return;
+
+    if (node.divided()) {
+        // Pairs lie either inside one child or across two siblings; join_rec prunes siblings too far apart
+        const Node *quadrants = childrenOf(node);
+        for (int i = 0; i < 4; ++i) {
+            selfJoin_rec(quadrants[i], r2, callback);
+            for (int j = i + 1; j < 4; ++j) {
+                join_rec(quadrants[i], *this, quadrants[j], r2, callback);
+            }
+        }
+        return;
+    }
+
+    // Leaf: test each point against the lanes after it, then the overflow list
+    std::array<float, CAPACITY> xs{}, ys{};
+    std::array<bool, CAPACITY> shown{}; // Lanes holding a point not hidden by ignoreOlderThan
+    const bool hiding = hidingStale();
+    for (int j = 0; j < node.point_count; ++j) {
+        xs[j] = node.points[j].x;
+        ys[j] = node.points[j].y;
+        shown[j] = !(hiding && hidden(node, j));
+    }
+    const std::span<const Point> overflow = overflowOf(node);
+    std::vector<bool> overflowShown(overflow.size());
+    for (size_t j = 0; j < overflow.size(); ++j) overflowShown[j] = !(hiding && hidden(node, node.point_count + static_cast<int>(j)));
+
+    for (int i = 0; i < node.point_count; ++i) {
+        if (!shown[i]) continue;
+        const Point &a = node.points[i];
+        std::array<bool, CAPACITY> within{};
+        for (int j = 0; j < CAPACITY; ++j) {
+            const float dx = a.x - xs[j];
+            const float dy = a.y - ys[j];
+            within[j] = dx * dx + dy * dy < r2;
+        }
+        for (int j = i + 1; j < node.point_count; ++j) {
+            if (within[j] && shown[j]) callback(a, node.points[j]);
+        }
+        for (size_t j = 0; j < overflow.size(); ++j) {
+            if (overflowShown[j] && distanceSquared(a, overflow[j]) < r2) callback(a, overflow[j]);
+        }
+    }
+    for (size_t i = 0; i < overflow.size(); ++i) {
+        if (!overflowShown[i]) continue;
+        for (size_t j = i + 1; j < overflow.size(); ++j) {
+            if (overflowShown[j] && distanceSquared(overflow[i], overflow[j]) < r2) callback(overflow[i], overflow[j]);
+        }
+    }
+}
+
+// Runs the loop body on a shared atomic counter so workers pick up tasks as they free up
+template<typename Body>
+void QuadTree::parallelFor(const size_t count, unsigned threads, Body &&body) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+            body(i);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (std::thread &w : workers) w.join();
+}
+
 #endif // QUADTREE_TPP
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 #include "QuadTree.hpp"
+#include "TestHelpers.hpp"
+
+#include <mutex>
+#include <random>
 
 class QuadTreeTest : public ::testing::Test {
 protected:
@@ -231,6 +235,31 @@ TEST_F(QuadTreeTest, NearestNeighborsRequest8FewerPoints) {
     EXPECT_EQ(nearest[3], Point(-10.0f, -10.0f));
     EXPECT_EQ(nearest[4], Point());  // Default value since there are no more points
 }
+// Test a node queue reused across searches while inserts keep reallocating the arena
+TEST_F(QuadTreeTest, NearestNeighborsQueueReuseAcrossGrowth) {
+    std::array<Point, 3> nearest;
+    float maxDist = 0.0f;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    std::vector<Point> inserted;
+    for (int round = 0; round < 40; ++round) {
+        for (int i = 0; i < 250; ++i) {
+            const int k = round * 250 + i;
+            inserted.emplace_back(static_cast<float>((k * 37) % 991) / 10.0f - 49.5f, static_cast<float>((k * 53) % 983) / 10.0f - 49.1f);
+            ASSERT_TRUE(tree->insert(inserted.back()));
+        }
+        // Three neighbours in a large tree stop the descent early, leaving entries in the queue
+        const Point target(static_cast<float>(round) - 20.0f, 7.0f - static_cast<float>(round) / 2.0f);
+        nearestHeap.clear();
+        tree->nearestNeighbors<3>(target, nearest, maxDist, nodeQueue, nearestHeap);
+        EXPECT_FALSE(nodeQueue.empty());
+
+        const std::vector<float> distances = bruteForce<3>(inserted, target);
+        EXPECT_EQ(maxDist, distances[2]);
+        for (size_t i = 0; i < 3; ++i) EXPECT_EQ(distanceSquared(target, nearest[i]), distances[2 - i]);
+    }
+}
+
 // Test nearest neighbor search with points in the same location
 TEST_F(QuadTreeTest, NearestNeighborsSameLocation) {
     tree->insert(Point(2.0f, 2.0f));
@@ -280,6 +309,1159 @@ TEST_F(QuadTreeTest, IdenticalPoints) {
     EXPECT_EQ(nearest[0], Point(5.0f, 5.0f));  // Nearest should be the identical point
 }
 
+// Test filtered KNN search keeping only points whose payload matches
+TEST_F(QuadTreeTest, NearestNeighborsFiltered) {
+    for (int i = -40; i <= 40; i += 10) {
+        for (int j = -40; j <= 40; j += 10) {
+            const float payload = (i == 40 || j == 40) ? 1.0f : 0.0f; // Only the far edges match
+            tree->insert(Point(static_cast<float>(i), static_cast<float>(j), payload));
+        }
+    }
+
+    std::array<Point, 3> nearest;
+    float maxDist = std::numeric_limits<float>::max();
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree->nearestNeighbors<3>(Point(35.0f, 35.0f), nearest, maxDist, nodeQueue, nearestHeap,
+                              [](const Point &p) { return p.payload == 1.0f; });
+
+    std::vector expected = {Point(40.0f, 40.0f), Point(30.0f, 40.0f), Point(40.0f, 30.0f)};
+    for (const auto& point : nearest) {
+        EXPECT_EQ(point.payload, 1.0f);
+        EXPECT_TRUE(std::ranges::find(expected, point) != expected.end());
+    }
+}
+
+// Test filtered KNN search pruning subtrees by their payload range
+TEST_F(QuadTreeTest, NearestNeighborsFilteredPrunesSubtrees) {
+    for (int i = -40; i <= 40; i += 10) {
+        for (int j = -40; j <= 40; j += 10) {
+            tree->insert(Point(static_cast<float>(i), static_cast<float>(j), static_cast<float>(i)));
+        }
+    }
+
+    int visitedRanges = 0;
+    std::array<Point, 2> nearest;
+    float maxDist = std::numeric_limits<float>::max();
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree->nearestNeighbors<2>(Point(40.0f, 3.0f), nearest, maxDist, nodeQueue, nearestHeap,
+                              [](const Point &p) { return p.payload < -35.0f; },
+                              [&](const float lo, float) { ++visitedRanges; return lo < -35.0f; });
+
+    EXPECT_EQ(nearest[0], Point(-40.0f, 10.0f));
+    EXPECT_EQ(nearest[1], Point(-40.0f, 0.0f));
+    EXPECT_GT(visitedRanges, 0);
+}
+
+// Test filtered KNN search when no point matches
+TEST_F(QuadTreeTest, NearestNeighborsFilteredNoMatch) {
+    tree->insert(Point(10.0f, 10.0f, 1.0f));
+    tree->insert(Point(20.0f, 20.0f, 2.0f));
+
+    std::array<Point, 2> nearest;
+    float maxDist = std::numeric_limits<float>::max();
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree->nearestNeighbors<2>(Point(0.0f, 0.0f), nearest, maxDist, nodeQueue, nearestHeap,
+                              [](const Point &p) { return p.payload > 5.0f; },
+                              [](float, const float hi) { return hi > 5.0f; });
+
+    EXPECT_EQ(nearest[0], Point());
+    EXPECT_EQ(nearest[1], Point());
+}
+
+// Test the incremental nearest neighbor iterator yields points in increasing distance
+TEST_F(QuadTreeTest, NearestNeighborIteratorOrder) {
+    for (int i = -40; i <= 40; i += 10) {
+        for (int j = -40; j <= 40; j += 10) {
+            tree->insert(Point(static_cast<float>(i), static_cast<float>(j)));
+        }
+    }
+
+    NearestNeighborIterator it(*tree, Point(12.0f, 3.0f));
+    Point point;
+    float distSq = 0.0f;
+    float previous = -1.0f;
+    int count = 0;
+    while (it.next(point, distSq)) {
+        EXPECT_GE(distSq, previous);
+        EXPECT_FLOAT_EQ(distSq, distanceSquared(point, Point(12.0f, 3.0f)));
+        if (count == 0) {
+            EXPECT_EQ(point, Point(10.0f, 0.0f));
+        }
+        previous = distSq;
+        ++count;
+    }
+    EXPECT_EQ(count, 81);  // Every point is yielded exactly once
+}
+
+// Test the incremental nearest neighbor iterator agrees with KNN when stopped early
+TEST_F(QuadTreeTest, NearestNeighborIteratorMatchesKnn) {
+    for (int i = -40; i <= 40; i += 10) {
+        for (int j = -40; j <= 40; j += 10) {
+            tree->insert(Point(static_cast<float>(i), static_cast<float>(j)));
+        }
+    }
+
+    std::array<Point, 3> nearest;
+    float maxDist = std::numeric_limits<float>::max();
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree->nearestNeighbors<3>(Point(-17.0f, 24.0f), nearest, maxDist, nodeQueue, nearestHeap);
+
+    NearestNeighborIterator it(*tree, Point(-17.0f, 24.0f));
+    for (int i = 2; i >= 0; --i) {
+        Point point;
+        ASSERT_TRUE(it.next(point));
+        EXPECT_EQ(point, nearest[i]);  // KNN output lists the farthest first
+    }
+}
+
+// Test the incremental nearest neighbor iterator on an empty tree
+TEST_F(QuadTreeTest, NearestNeighborIteratorEmptyTree) {
+    NearestNeighborIterator it(*tree, Point(0.0f, 0.0f));
+    Point point;
+    EXPECT_FALSE(it.next(point));
+}
+
+// Test Rect containment of another rectangle
+TEST_F(QuadTreeTest, RectContainsRect) {
+    const Rect rect(0.0f, 0.0f, 10.0f, 10.0f);
+    EXPECT_TRUE(rect.contains(Rect(5.0f, 5.0f, 5.0f, 5.0f)));    // Touches the edge from inside
+    EXPECT_FALSE(rect.contains(Rect(5.0f, 5.0f, 6.0f, 5.0f)));   // Sticks out on the right
+    EXPECT_FALSE(rect.contains(Rect(20.0f, 20.0f, 1.0f, 1.0f))); // Disjoint
+}
+
+// Test region aggregates against a brute-force computation
+TEST_F(QuadTreeTest, AggregateRegion) {
+    std::vector<Point> inserted;
+    for (int i = -40; i <= 40; i += 5) {
+        for (int j = -40; j <= 40; j += 5) {
+            inserted.emplace_back(static_cast<float>(i), static_cast<float>(j), static_cast<float>(i * j));
+            tree->insert(inserted.back());
+        }
+    }
+
+    for (const Rect &range : { Rect(0.0f, 0.0f, 50.0f, 50.0f), Rect(10.0f, -5.0f, 17.0f, 12.0f), Rect(-30.0f, 30.0f, 3.0f, 3.0f) }) {
+        PayloadAggregate expected;
+        for (const Point &p : inserted) {
+            if (range.contains(p)) expected.add(p);
+        }
+
+        const PayloadAggregate result = tree->aggregate(range);
+        EXPECT_EQ(result.count, expected.count);
+        EXPECT_DOUBLE_EQ(result.sum, expected.sum);
+        EXPECT_EQ(result.min, expected.min);
+        EXPECT_EQ(result.max, expected.max);
+    }
+}
+
+// Test region aggregates over an area without points
+TEST_F(QuadTreeTest, AggregateEmptyRegion) {
+    tree->insert(Point(10.0f, 10.0f, 3.0f));
+
+    const PayloadAggregate result = tree->aggregate(Rect(-20.0f, -20.0f, 5.0f, 5.0f));
+    EXPECT_EQ(result.count, 0);
+    EXPECT_EQ(result.sum, 0.0);
+}
+
+// Test rasterization matches brute-force binning when pixels align with the tree's cells
+TEST_F(QuadTreeTest, RasterizeAlignedGrid) {
+    std::vector<Point> inserted;
+    for (int i = 0; i < 20; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            inserted.emplace_back(-47.5f + 5.0f * static_cast<float>(i), -47.5f + 5.0f * static_cast<float>(j * j % 20));
+            tree->insert(inserted.back());
+        }
+    }
+
+    constexpr int width = 16, height = 8;
+    std::vector<std::uint32_t> expected(width * height, 0);
+    for (const Point &p : inserted) {
+        const int c = static_cast<int>((p.x + 50.0f) / (100.0f / width));
+        const int r = static_cast<int>((p.y + 50.0f) / (100.0f / height));
+        ++expected[r * width + c];
+    }
+
+    std::vector<std::uint32_t> raster(width * height, 7);
+    EXPECT_TRUE(tree->rasterize(Rect(0.0f, 0.0f, 50.0f, 50.0f), width, height, raster, 3));
+    EXPECT_EQ(raster, expected);
+}
+
+// Test rasterization keeps every point in view exactly once on an unaligned grid
+TEST_F(QuadTreeTest, RasterizeConservesCount) {
+    for (int i = -40; i <= 40; i += 3) {
+        for (int j = -40; j <= 40; j += 7) {
+            tree->insert(Point(static_cast<float>(i), static_cast<float>(j)));
+        }
+    }
+
+    std::vector<std::uint32_t> raster(13 * 9);
+    EXPECT_TRUE(tree->rasterize(Rect(0.0f, 0.0f, 50.0f, 50.0f), 13, 9, raster, 4));
+    long long total = 0;
+    for (const std::uint32_t count : raster) total += count;
+    EXPECT_EQ(total, tree->aggregate(Rect(0.0f, 0.0f, 50.0f, 50.0f)).count);
+
+    EXPECT_FALSE(tree->rasterize(Rect(0.0f, 0.0f, 50.0f, 50.0f), 14, 9, raster));  // Output buffer too small
+}
+
+// Test the spatial join between two trees against a brute-force pair search
+TEST_F(QuadTreeTest, JoinWithinMatchesBruteForce) {
+    QuadTree other(Rect(20.0f, 10.0f, 40.0f, 40.0f));
+    std::vector<Point> left, right;
+    for (int i = -45; i <= 45; i += 6) {
+        for (int j = -45; j <= 45; j += 4) {
+            left.emplace_back(static_cast<float>(i), static_cast<float>(j));
+            tree->insert(left.back());
+        }
+    }
+    for (int i = -19; i <= 59; i += 5) {
+        for (int j = -29; j <= 49; j += 7) {
+            right.emplace_back(static_cast<float>(i) + 0.5f, static_cast<float>(j) + 0.25f);
+            other.insert(right.back());
+        }
+    }
+
+    std::vector<std::pair<Point, Point>> expected;
+    for (const Point &a : left) {
+        for (const Point &b : right) {
+            if (distanceSquared(a, b) < 9.0f) expected.emplace_back(a, b);
+        }
+    }
+    std::ranges::sort(expected);
+
+    for (const unsigned threads : { 1u, 4u }) {
+        std::mutex mutex;
+        std::vector<std::pair<Point, Point>> found;
+        tree->joinWithin(other, 3.0f, [&](const Point &a, const Point &b) {
+            const std::lock_guard lock(mutex);
+            found.emplace_back(a, b);
+        }, threads);
+        std::ranges::sort(found);
+        EXPECT_EQ(found, expected);
+    }
+}
+
+// Test the spatial join of trees that are too far apart to share any pair
+TEST_F(QuadTreeTest, JoinWithinDisjointTrees) {
+    QuadTree other(Rect(500.0f, 500.0f, 50.0f, 50.0f));
+    tree->insert(Point(10.0f, 10.0f));
+    other.insert(Point(480.0f, 480.0f));
+
+    int pairs = 0;
+    tree->joinWithin(other, 10.0f, [&](const Point &, const Point &) { ++pairs; });
+    EXPECT_EQ(pairs, 0);
+}
+
+// Test the self-join reports every close pair exactly once
+TEST_F(QuadTreeTest, ForEachPairWithinMatchesBruteForce) {
+    std::vector<Point> inserted;
+    for (int i = -45; i <= 45; i += 3) {
+        for (int j = -45; j <= 45; j += 4) {
+            inserted.emplace_back(static_cast<float>(i) + 0.1f * static_cast<float>(j % 7), static_cast<float>(j));
+            tree->insert(inserted.back());
+        }
+    }
+    for (int i = 0; i < 6; ++i) {
+        inserted.emplace_back(7.0f, 7.0f);  // Coincident points forming pairs among themselves
+        tree->insert(inserted.back());
+    }
+
+    auto ordered = [](const Point &a, const Point &b) { return b < a ? std::make_pair(b, a) : std::make_pair(a, b); };
+    std::vector<std::pair<Point, Point>> expected;
+    for (size_t i = 0; i < inserted.size(); ++i) {
+        for (size_t j = i + 1; j < inserted.size(); ++j) {
+            if (distanceSquared(inserted[i], inserted[j]) < 16.0f) expected.push_back(ordered(inserted[i], inserted[j]));
+        }
+    }
+    std::ranges::sort(expected);
+
+    for (const unsigned threads : { 1u, 3u }) {
+        std::mutex mutex;
+        std::vector<std::pair<Point, Point>> found;
+        tree->forEachPairWithin(4.0f, [&](const Point &a, const Point &b) {
+            const std::lock_guard lock(mutex);
+            found.push_back(ordered(a, b));
+        }, threads);
+        std::ranges::sort(found);
+        EXPECT_EQ(found, expected);
+    }
+}
+
+// Test a raycast reports the first point along the ray
+TEST_F(QuadTreeTest, RaycastFirstHit) {
+    for (int i = -40; i <= 40; i += 10) {
+        for (int j = -40; j <= 40; j += 10) {
+            tree->insert(Point(static_cast<float>(i), static_cast<float>(j), static_cast<float>(i + j)));
+        }
+    }
+
+    RayHit hit;
+    ASSERT_TRUE(tree->raycast(Point(-45.0f, 10.5f), Point(2.0f, 0.0f), 100.0f, 1.0f, hit));
+    EXPECT_EQ(hit.point, Point(-40.0f, 10.0f));
+    EXPECT_FLOAT_EQ(hit.t, 5.0f);
+
+    // Diagonal ray starting between lattice points, heading away from the origin
+    ASSERT_TRUE(tree->raycast(Point(1.0f, 1.0f), Point(1.0f, 1.0f), 100.0f, 0.5f, hit));
+    EXPECT_EQ(hit.point, Point(10.0f, 10.0f));
+
+    EXPECT_FALSE(tree->raycast(Point(-45.0f, 15.0f), Point(1.0f, 0.0f), 100.0f, 1.0f, hit));  // Runs between rows
+    EXPECT_FALSE(tree->raycast(Point(-45.0f, 10.0f), Point(1.0f, 0.0f), 4.0f, 0.5f, hit));    // Stops short
+    EXPECT_FALSE(tree->raycast(Point(-45.0f, 10.0f), Point(-1.0f, 0.0f), 100.0f, 0.5f, hit)); // Points away
+}
+
+// Test a raycast matches a brute-force scan for many directions
+TEST_F(QuadTreeTest, RaycastMatchesBruteForce) {
+    std::vector<Point> inserted;
+    for (int i = 0; i < 300; ++i) {
+        inserted.emplace_back(static_cast<float>((i * 37) % 97) - 48.0f, static_cast<float>((i * 61) % 89) - 44.0f);
+        tree->insert(inserted.back());
+    }
+
+    for (int k = 0; k < 16; ++k) {
+        const float angle = static_cast<float>(k) * 0.39f;
+        const Point origin(-3.0f, 2.0f);
+        const Point dir(std::cos(angle), std::sin(angle));
+
+        float best = std::numeric_limits<float>::max();
+        for (const Point &p : inserted) {
+            const float t = (p.x - origin.x) * dir.x + (p.y - origin.y) * dir.y;
+            if (t >= 0.0f && t <= 60.0f && distanceSquared(p, origin) - t * t <= 0.75f * 0.75f) best = std::min(best, t);
+        }
+
+        RayHit hit;
+        if (best == std::numeric_limits<float>::max()) {
+            EXPECT_FALSE(tree->raycast(origin, dir, 60.0f, 0.75f, hit));
+        } else {
+            ASSERT_TRUE(tree->raycast(origin, dir, 60.0f, 0.75f, hit));
+            EXPECT_NEAR(hit.t, best, 1e-4f);
+        }
+    }
+}
+
+// Test segment queries against a brute-force point-to-segment distance
+TEST_F(QuadTreeTest, QuerySegment) {
+    std::vector<Point> inserted;
+    for (int i = -45; i <= 45; i += 3) {
+        for (int j = -45; j <= 45; j += 3) {
+            inserted.emplace_back(static_cast<float>(i), static_cast<float>(j));
+            tree->insert(inserted.back());
+        }
+    }
+
+    const Point a(-30.0f, -20.0f), b(25.0f, 35.0f);
+    std::vector<Point> found;
+    tree->querySegment(a, b, 2.0f, [&](const Point &p) { found.push_back(p); });
+
+    std::vector<Point> expected;
+    for (const Point &p : inserted) {
+        const float t = std::clamp(((p.x - a.x) * (b.x - a.x) + (p.y - a.y) * (b.y - a.y)) / distanceSquared(a, b), 0.0f, 1.0f);
+        if (distanceSquared(p, Point(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y))) <= 4.0f) expected.push_back(p);
+    }
+    std::sort(found.begin(), found.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(found, expected);
+    EXPECT_FALSE(found.empty());
+}
+
+// Test polygon queries against a brute-force crossing-number test
+TEST_F(QuadTreeTest, QueryPolygon) {
+    std::vector<Point> inserted;
+    for (int i = -48; i <= 48; i += 2) {
+        for (int j = -48; j <= 48; j += 2) {
+            inserted.emplace_back(static_cast<float>(i) + 0.3f, static_cast<float>(j) + 0.7f);
+            tree->insert(inserted.back());
+        }
+    }
+
+    // A concave "L" shaped geofence, listed clockwise, and a triangle listed counter-clockwise
+    const std::vector<std::vector<Point>> polygons = {
+        { Point(-40.0f, -40.0f), Point(30.0f, -40.0f), Point(30.0f, -10.0f), Point(-10.0f, -10.0f), Point(-10.0f, 35.0f), Point(-40.0f, 35.0f) },
+        { Point(0.0f, 45.0f), Point(45.0f, 45.0f), Point(20.0f, 5.0f) },
+    };
+    for (const auto &polygon : polygons) {
+        std::vector<Point> found;
+        tree->queryPolygon(polygon, [&](const Point &p) { found.push_back(p); });
+
+        std::vector<Point> expected;
+        for (const Point &p : inserted) {
+            bool inside = false;
+            for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+                if ((polygon[i].y > p.y) != (polygon[j].y > p.y) &&
+                    p.x < (polygon[j].x - polygon[i].x) * (p.y - polygon[i].y) / (polygon[j].y - polygon[i].y) + polygon[i].x) {
+                    inside = !inside;
+                }
+            }
+            if (inside) expected.push_back(p);
+        }
+
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(found, expected);
+        EXPECT_FALSE(found.empty());
+    }
+}
+
+// Test polygon queries with a degenerate polygon
+TEST_F(QuadTreeTest, QueryPolygonDegenerate) {
+    tree->insert(Point(1.0f, 1.0f));
+    const std::vector<Point> segment = { Point(0.0f, 0.0f), Point(5.0f, 5.0f) };
+
+    int hits = 0;
+    tree->queryPolygon(segment, [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 0);
+}
+
+// Test a growable root expands toward points outside it and keeps every point
+TEST_F(QuadTreeTest, GrowableRoot) {
+    QuadTree growing(Rect(0.0f, 0.0f, 10.0f, 10.0f), true);
+    std::vector<Point> inserted;
+    for (int i = -8; i <= 8; i += 4) {
+        for (int j = -8; j <= 8; j += 4) {
+            inserted.emplace_back(static_cast<float>(i), static_cast<float>(j), 1.0f);
+            EXPECT_TRUE(growing.insert(inserted.back()));
+        }
+    }
+    for (const Point &far : { Point(75.0f, -3.0f, 1.0f), Point(-130.0f, 260.0f, 1.0f), Point(0.5f, -999.0f, 1.0f) }) {
+        inserted.push_back(far);
+        EXPECT_TRUE(growing.insert(far));
+        EXPECT_TRUE(growing.getBoundary().contains(far));
+    }
+    EXPECT_TRUE(growing.getBoundary().contains(Rect(0.0f, 0.0f, 10.0f, 10.0f)));  // The original area is still covered
+
+    const PayloadAggregate all = growing.aggregate(growing.getBoundary());
+    EXPECT_EQ(all.count, static_cast<long long>(inserted.size()));
+
+    NearestNeighborIterator it(growing, Point(70.0f, 0.0f));
+    Point nearest;
+    ASSERT_TRUE(it.next(nearest));
+    EXPECT_EQ(nearest, Point(75.0f, -3.0f));
+
+    std::array<Point, 1> knn;
+    float maxDist = std::numeric_limits<float>::max();
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    growing.nearestNeighbors<1>(Point(1.0f, 1.0f), knn, maxDist, nodeQueue, nearestHeap);
+    EXPECT_EQ(knn[0], Point(0.0f, 0.0f));
+}
+
+// Test growing a root whose edges are off the power-of-two grid keeps every point reachable
+TEST_F(QuadTreeTest, GrowableRootOffGrid) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> coordinate(-300.0f, 300.0f);
+    for (int trial = 0; trial < 50; ++trial) {
+        QuadTree growing(Rect(0.1f, 0.3f, 0.7f, 0.9f), true);
+        std::vector<Point> inserted;
+        for (int i = 0; i < 200; ++i) {
+            inserted.emplace_back(coordinate(rng), coordinate(rng));
+            ASSERT_TRUE(growing.insert(inserted.back()));
+        }
+        int exponent;
+        EXPECT_EQ(std::frexp(growing.getBoundary().w, &exponent), 0.5f);  // Snapped onto power-of-two extents
+        EXPECT_EQ(std::frexp(growing.getBoundary().h, &exponent), 0.5f);
+
+        for (const Point &p : inserted) {
+            int hits = 0;
+            growing.queryRange(Rect(p.x, p.y, 0.0f, 0.0f), [&](const Point &) { ++hits; });
+            EXPECT_EQ(hits, 1);
+        }
+
+        NearestNeighborIterator it(growing, Point(0.0f, 0.0f));
+        Point next;
+        size_t visited = 0;
+        while (it.next(next)) ++visited;
+        EXPECT_EQ(visited, inserted.size());
+
+        std::array<Point, 8> previous, seeded, cold;
+        for (size_t i = 0; i + 1 < inserted.size(); i += 9) {
+            growing.nearestNeighbors<8>(inserted[i], previous);
+            ASSERT_EQ(growing.nearestNeighborsSeeded<8>(inserted[i + 1], previous, seeded), 8u);
+            growing.nearestNeighbors<8>(inserted[i + 1], cold);
+            for (size_t k = 0; k < 8; ++k) {
+                EXPECT_EQ(distanceSquared(inserted[i + 1], seeded[k]), distanceSquared(inserted[i + 1], cold[k]));
+            }
+        }
+
+        for (const Point &p : inserted) EXPECT_TRUE(growing.remove(p));
+        EXPECT_EQ(growing.aggregate(growing.getBoundary()).count, 0);
+    }
+}
+
+// Test a non-growable root still rejects points outside it
+TEST_F(QuadTreeTest, FixedRootRejectsOutside) {
+    QuadTree fixed(Rect(0.0f, 0.0f, 10.0f, 10.0f), false);
+    EXPECT_FALSE(fixed.insert(Point(20.0f, 0.0f)));
+    EXPECT_EQ(fixed.getBoundary(), Rect(0.0f, 0.0f, 10.0f, 10.0f));
+}
+
+// Test relayout keeps every query result and later inserts working
+TEST_F(QuadTreeTest, OptimizeKeepsResults) {
+    for (int i = -48; i <= 48; i += 3) {
+        for (int j = -48; j <= 48; j += 5) {
+            tree->insert(Point(static_cast<float>(i) + 0.25f, static_cast<float>(j) - 0.5f, static_cast<float>(i * j)));
+        }
+    }
+    for (int k = 0; k < 12; ++k) tree->insert(Point(7.25f, 11.5f, 1.0f));  // Duplicates reach the overflow list
+
+    const Point target(3.0f, -4.0f);
+    auto snapshot = [&]() {
+        std::array<Point, 10> knn;
+        float maxDist = std::numeric_limits<float>::max();
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+        std::vector<std::pair<float, Point>> nearestHeap;
+        tree->nearestNeighbors<10>(target, knn, maxDist, nodeQueue, nearestHeap);
+
+        std::vector<Point> ordered;
+        NearestNeighborIterator it(*tree, Point(7.0f, 11.0f));
+        Point p;
+        for (int k = 0; k < 20 && it.next(p); ++k) ordered.push_back(p);
+
+        std::vector<Point> inside;
+        const std::vector<Point> triangle = { Point(-30.0f, -30.0f), Point(40.0f, -10.0f), Point(0.0f, 35.0f) };
+        tree->queryPolygon(triangle, [&](const Point &q) { inside.push_back(q); });
+        std::sort(inside.begin(), inside.end());
+
+        const PayloadAggregate sum = tree->aggregate(Rect(5.0f, 5.0f, 20.0f, 12.0f));
+        return std::make_tuple(std::vector<Point>(knn.begin(), knn.end()), ordered, inside, sum.count, sum.sum);
+    };
+
+    const auto before = snapshot();
+    tree->optimize();
+    EXPECT_EQ(snapshot(), before);
+
+    EXPECT_TRUE(tree->insert(Point(3.25f, -4.25f)));
+    std::array<Point, 1> knn;
+    float maxDist = std::numeric_limits<float>::max();
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree->nearestNeighbors<1>(target, knn, maxDist, nodeQueue, nearestHeap);
+    EXPECT_EQ(knn[0], Point(3.25f, -4.25f));
+}
+
+// Test prefetching never changes query results
+TEST_F(QuadTreeTest, PrefetchDistance) {
+    tree->setPrefetchDistance(-3);
+    EXPECT_EQ(tree->getPrefetchDistance(), 0);  // Negative distances disable prefetching
+
+    for (int i = -48; i <= 48; i += 4) {
+        for (int j = -48; j <= 48; j += 3) {
+            tree->insert(Point(static_cast<float>(i) + 0.5f, static_cast<float>(j) + 0.25f));
+        }
+    }
+
+    auto query = [&](const int distance) {
+        tree->setPrefetchDistance(distance);
+        std::array<Point, 6> knn;
+        float maxDist = std::numeric_limits<float>::max();
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+        std::vector<std::pair<float, Point>> nearestHeap;
+        tree->nearestNeighbors<6>(Point(-7.0f, 13.0f), knn, maxDist, nodeQueue, nearestHeap);
+        return knn;
+    };
+    const auto expected = query(0);
+    for (const int distance : { 1, 2, 8, 1000 }) {
+        EXPECT_EQ(query(distance), expected);
+    }
+}
+
+// Test locate follows the insertion path, sending centre-line points east and north
+TEST_F(QuadTreeTest, LocateLeaf) {
+    Rect leaf;
+    ASSERT_TRUE(tree->locate(Point(3.0f, 3.0f), leaf));
+    EXPECT_EQ(leaf, tree->getBoundary());  // An undivided root is the only leaf
+
+    for (int i = 0; i <= QuadTree::capacity(); ++i) {
+        tree->insert(Point(-10.0f - static_cast<float>(i), 10.0f + static_cast<float>(i)));
+    }
+    ASSERT_TRUE(tree->isDivided());
+
+    ASSERT_TRUE(tree->locate(Point(0.0f, 0.0f), leaf));
+    EXPECT_EQ(leaf, Rect(25.0f, -25.0f, 25.0f, 25.0f));  // Centre goes northeast
+    ASSERT_TRUE(tree->locate(Point(-1.0f, 0.0f), leaf));
+    EXPECT_EQ(leaf, Rect(-25.0f, -25.0f, 25.0f, 25.0f));
+    ASSERT_TRUE(tree->locate(Point(0.0f, 1.0f), leaf));
+    EXPECT_EQ(leaf, Rect(25.0f, 25.0f, 25.0f, 25.0f));
+    ASSERT_TRUE(tree->locate(Point(-50.0f, 50.0f), leaf));  // Root corner, edges included
+    EXPECT_TRUE(leaf.contains(Point(-50.0f, 50.0f)));
+    EXPECT_LT(leaf.w, 25.0f);  // The crowded southwest quadrant was split again
+    EXPECT_FALSE(tree->locate(Point(50.5f, 0.0f), leaf));
+
+    // Every stored point is found in the leaf locate reports for it
+    tree->insert(Point(0.0f, 0.0f));
+    tree->insert(Point(0.0f, 50.0f));
+    for (const Point &p : { Point(0.0f, 0.0f), Point(0.0f, 50.0f), Point(-14.0f, 14.0f) }) {
+        ASSERT_TRUE(tree->locate(p, leaf));
+        EXPECT_TRUE(leaf.contains(p));
+        EXPECT_GT(tree->aggregate(leaf).count, 0);
+    }
+}
+
+// Test that child boundaries hold every point routed to them when the root's centre and extents do not halve exactly
+TEST_F(QuadTreeTest, ChildBoundariesHoldRoutedPoints) {
+    QuadTree skewed(Rect(-0.600000381f, -0.600000381f, 44.7999992f, 57.5999985f));
+    const std::vector<Point> points = { Point(30.7105f, 21.7392f), Point(-28.7266f, -12.9916f), Point(-25.0f, -15.0f),
+                                        Point(-35.0f, -5.0f), Point(-37.3474f, -21.4281f), Point(-28.0134f, -15.6654f) };
+    for (const Point &p : points) ASSERT_TRUE(skewed.insert(p));
+    ASSERT_TRUE(skewed.isDivided());
+
+    Rect leaf;
+    for (const Point &p : points) {
+        ASSERT_TRUE(skewed.locate(p, leaf));
+        EXPECT_TRUE(leaf.contains(p));
+        int hits = 0;
+        skewed.queryRange(Rect(p.x, p.y, 0.0f, 0.0f), [&](const Point &) { ++hits; });
+        EXPECT_EQ(hits, 1);
+        EXPECT_EQ(skewed.aggregate(Rect(p.x, p.y, 0.0f, 0.0f)).count, 1);
+    }
+    for (const Point &p : points) EXPECT_TRUE(skewed.remove(p));
+    EXPECT_FALSE(skewed.isDivided());
+}
+
+// Test batched insertion matches point-by-point insertion, including merging into a non-empty tree
+TEST_F(QuadTreeTest, InsertBatch) {
+    std::vector<Point> batch;
+    for (int i = 0; i < 2000; ++i) {
+        const float x = static_cast<float>((i * 37) % 101) - 50.0f;
+        const float y = static_cast<float>((i * 53) % 97) - 48.5f;
+        batch.emplace_back(x, y, static_cast<float>(i % 17));
+    }
+    for (int k = 0; k < 9; ++k) batch.emplace_back(12.0f, -7.0f, 2.0f);  // Duplicates reach the overflow list
+    batch.emplace_back(75.0f, 0.0f);  // Outside the root
+    batch.emplace_back(0.0f, -51.0f);
+
+    QuadTree sequential(tree->getBoundary());
+    size_t accepted = 0;
+    for (const Point &p : batch) accepted += sequential.insert(p);
+
+    // Merge in two batches, the second into an already populated tree
+    const std::span<Point> all(batch);
+    const size_t half = all.size() / 2;
+    EXPECT_EQ(tree->insertBatch(all.first(half)) + tree->insertBatch(all.subspan(half)), accepted);
+    EXPECT_EQ(accepted, batch.size() - 2);
+
+    const PayloadAggregate expected = sequential.aggregate(sequential.getBoundary());
+    const PayloadAggregate actual = tree->aggregate(tree->getBoundary());
+    EXPECT_EQ(actual.count, expected.count);
+    EXPECT_EQ(actual.sum, expected.sum);
+    EXPECT_EQ(actual.min, expected.min);
+    EXPECT_EQ(actual.max, expected.max);
+
+    for (const Point &target : { Point(0.5f, 0.5f), Point(12.0f, -7.0f), Point(-49.0f, 47.0f) }) {
+        NearestNeighborIterator fromBatch(*tree, target);
+        NearestNeighborIterator fromInserts(sequential, target);
+        Point a, b;
+        float da = 0.0f, db = 0.0f;
+        for (int k = 0; k < 30; ++k) {
+            ASSERT_TRUE(fromBatch.next(a, da));
+            ASSERT_TRUE(fromInserts.next(b, db));
+            EXPECT_EQ(da, db);
+        }
+    }
+
+    const PayloadAggregate region = tree->aggregate(Rect(-10.0f, 20.0f, 15.0f, 9.0f));
+    EXPECT_EQ(region.count, sequential.aggregate(Rect(-10.0f, 20.0f, 15.0f, 9.0f)).count);
+}
+
+// Test batched insertion into a growable root
+TEST_F(QuadTreeTest, InsertBatchGrowable) {
+    QuadTree growing(Rect(0.0f, 0.0f, 10.0f, 10.0f), true);
+    std::vector<Point> batch = { Point(1.0f, 1.0f), Point(-300.0f, 20.0f), Point(45.0f, 900.0f), Point(2.0f, -3.0f) };
+    EXPECT_EQ(growing.insertBatch(batch), batch.size());
+    EXPECT_EQ(growing.aggregate(growing.getBoundary()).count, 4);
+    EXPECT_TRUE(growing.getBoundary().contains(Point(-300.0f, 20.0f)));
+    EXPECT_TRUE(growing.getBoundary().contains(Point(45.0f, 900.0f)));
+}
+
+// Runs KNN under Metric and checks the keys against a brute-force scan
+template<typename Metric>
+static void expectNearestByMetric(const QuadTree &tree, const std::vector<Point> &inserted, const Point &target) {
+    std::vector<float> keys;
+    for (const Point &p : inserted) {
+        if (p != target) keys.push_back(Metric::key(target, p));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::array<Point, 7> nearest;
+    float maxDist = 0.0f;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree.nearestNeighborsBy<Metric, 7>(target, nearest, maxDist, nodeQueue, nearestHeap);
+    for (size_t i = 0; i < nearest.size(); ++i) {
+        EXPECT_FLOAT_EQ(Metric::key(target, nearest[i]), keys[nearest.size() - 1 - i]);
+    }
+    EXPECT_FLOAT_EQ(maxDist, keys[nearest.size() - 1]);
+}
+
+// Test nearest neighbors under every planar metric
+TEST_F(QuadTreeTest, NearestNeighborsByMetric) {
+    std::vector<Point> inserted;
+    for (int i = 0; i < 1500; ++i) {
+        inserted.emplace_back(static_cast<float>((i * 37) % 97) - 48.5f, static_cast<float>((i * 59) % 89) - 44.25f);
+        tree->insert(inserted.back());
+    }
+    for (const Point &target : { Point(0.3f, 0.1f), Point(-47.0f, 40.0f), Point(22.0f, -9.5f) }) {
+        expectNearestByMetric<EuclideanMetric>(*tree, inserted, target);
+        expectNearestByMetric<ManhattanMetric>(*tree, inserted, target);
+        expectNearestByMetric<ChebyshevMetric>(*tree, inserted, target);
+    }
+}
+
+// Test the great-circle box bound is below, and close to, the distance to the nearest point of the box
+TEST_F(QuadTreeTest, HaversineLowerBound) {
+    const std::vector<Rect> boxes = { Rect(10.0f, 45.0f, 5.0f, 3.0f), Rect(-170.0f, -20.0f, 8.0f, 10.0f),
+                                      Rect(175.0f, 60.0f, 10.0f, 20.0f), Rect(0.0f, 80.0f, 60.0f, 8.0f) };
+    const std::vector<Point> targets = { Point(0.0f, 0.0f), Point(179.0f, -25.0f), Point(-178.0f, 62.0f),
+                                         Point(12.0f, 46.0f), Point(100.0f, 70.0f), Point(-60.0f, -85.0f) };
+    for (const Rect &box : boxes) {
+        for (const Point &target : targets) {
+            // The nearest point of the box lies on its outline unless the target is inside
+            float sampled = std::numeric_limits<float>::max();
+            constexpr int STEPS = 2000;
+            for (int i = 0; i <= STEPS; ++i) {
+                const float t = static_cast<float>(i) / STEPS;
+                const float lon = box.x - box.w + 2 * box.w * t;
+                const float lat = box.y - box.h + 2 * box.h * t;
+                for (const Point &p : { Point(lon, box.y - box.h), Point(lon, box.y + box.h),
+                                        Point(box.x - box.w, lat), Point(box.x + box.w, lat) }) {
+                    sampled = std::min(sampled, HaversineMetric::key(target, p));
+                }
+            }
+            for (const float wrap : { -360.0f, 0.0f, 360.0f }) {
+                if (box.contains(Point(target.x + wrap, target.y))) sampled = 0.0f;  // Inside, counting longitude wrap
+            }
+
+            const float bound = HaversineMetric::meters(HaversineMetric::lowerBound(target, box));
+            const float nearest = HaversineMetric::meters(sampled);
+            EXPECT_LE(bound, nearest * 1.0001f + 1.0f);
+            EXPECT_GE(bound, nearest * 0.999f - 1000.0f);
+        }
+    }
+}
+
+// Test great-circle nearest neighbors reach across the antimeridian
+TEST_F(QuadTreeTest, NearestNeighborsHaversine) {
+    QuadTree globe(Rect(0.0f, 0.0f, 180.0f, 90.0f));
+    std::vector<Point> inserted;
+    for (int i = 0; i < 2000; ++i) {
+        inserted.emplace_back(static_cast<float>((i * 7919) % 3600) / 10.0f - 180.0f, static_cast<float>((i * 104729) % 1790) / 10.0f - 89.5f);
+        globe.insert(inserted.back());
+    }
+    for (const Point &p : { Point(-179.9f, 10.0f), Point(178.0f, 10.0f), Point(-179.5f, 10.5f) }) {
+        inserted.push_back(p);
+        globe.insert(p);
+    }
+
+    std::array<Point, 1> nearest;
+    float maxDist = 0.0f;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    globe.nearestNeighborsBy<HaversineMetric, 1>(Point(179.8f, 10.0f), nearest, maxDist, nodeQueue, nearestHeap);
+    EXPECT_EQ(nearest[0], Point(-179.9f, 10.0f));  // 0.3 degrees away across the antimeridian
+    EXPECT_NEAR(HaversineMetric::meters(maxDist), 32830.0f, 100.0f);
+
+    for (const Point &target : { Point(179.8f, 10.0f), Point(-179.0f, -60.0f), Point(0.0f, 89.0f), Point(45.0f, 45.0f) }) {
+        expectNearestByMetric<HaversineMetric>(globe, inserted, target);
+    }
+}
+
+// Test every memory policy answers queries like the default heap arena
+TEST_F(QuadTreeTest, MemoryPolicy) {
+    const std::array<MemoryPolicy, 4> policies = {
+        MemoryPolicy{MemoryPolicy::Pages::Transparent, false},
+        MemoryPolicy{MemoryPolicy::Pages::HugeTLB, false},
+        MemoryPolicy{MemoryPolicy::Pages::Default, true},
+        MemoryPolicy{MemoryPolicy::Pages::Transparent, true},
+    };
+    auto fill = [](QuadTree &target) {
+        for (int i = 0; i < 40000; ++i) {
+            target.insert(Point(static_cast<float>((i * 7919) % 10007) / 100.0f - 50.0f, static_cast<float>((i * 4999) % 9973) / 100.0f - 49.0f, static_cast<float>(i % 13)));
+        }
+    };
+    fill(*tree);
+    EXPECT_EQ(tree->getMemoryPolicy(), MemoryPolicy());
+
+    std::array<Point, 8> nearest;
+    float expectedDist = 0.0f, maxDist = 0.0f;
+    auto knn = [&](const QuadTree &target, float &dist) {
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+        std::vector<std::pair<float, Point>> nearestHeap;
+        target.nearestNeighbors<8>(Point(3.3f, -7.7f), nearest, dist, nodeQueue, nearestHeap);
+    };
+    knn(*tree, expectedDist);
+    const PayloadAggregate expectedSum = tree->aggregate(Rect(-5.0f, 5.0f, 20.0f, 15.0f));
+
+    for (const MemoryPolicy &policy : policies) {
+        // Set before filling, so the arena grows in mapped memory
+        QuadTree mapped(tree->getBoundary());
+        mapped.setMemoryPolicy(policy);
+        fill(mapped);
+        EXPECT_EQ(mapped.getMemoryPolicy(), policy);
+        knn(mapped, maxDist);
+        EXPECT_EQ(maxDist, expectedDist);
+        EXPECT_EQ(mapped.aggregate(Rect(-5.0f, 5.0f, 20.0f, 15.0f)).sum, expectedSum.sum);
+
+        // Moving a filled arena, then relaying it out, keeps the policy and the answers
+        QuadTree moved(tree->getBoundary());
+        fill(moved);
+        moved.setMemoryPolicy(policy);
+        moved.optimize();
+        EXPECT_EQ(moved.getMemoryPolicy(), policy);
+        knn(moved, maxDist);
+        EXPECT_EQ(maxDist, expectedDist);
+    }
+}
+
+// Test mapped allocations are huge-page aligned and small ones stay on the heap
+TEST_F(QuadTreeTest, PageMapping) {
+    const MemoryPolicy transparent{MemoryPolicy::Pages::Transparent, false};
+    EXPECT_FALSE(usesPageMapping(64 << 20, MemoryPolicy()));
+    EXPECT_FALSE(usesPageMapping(4096, transparent));
+    EXPECT_TRUE(usesPageMapping(HUGE_PAGE_SIZE, transparent));
+
+    for (const MemoryPolicy &policy : {transparent, MemoryPolicy{MemoryPolicy::Pages::HugeTLB, true}}) {
+        const size_t bytes = 3 * HUGE_PAGE_SIZE + 123;
+        auto *bytesMapped = static_cast<unsigned char *>(mapPages(bytes, policy));
+        ASSERT_NE(bytesMapped, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(bytesMapped) % HUGE_PAGE_SIZE, 0u);
+        bytesMapped[0] = 1;
+        bytesMapped[bytes - 1] = 2;
+        EXPECT_EQ(bytesMapped[0] + bytesMapped[bytes - 1], 3);
+        unmapPages(bytesMapped, bytes);
+    }
+}
+
+// Test removing and moving points keeps summaries exact and merges nodes that fit their parent again
+TEST_F(QuadTreeTest, RemoveAndMove) {
+    std::vector<Point> inserted;
+    for (int i = 0; i < 600; ++i) {
+        inserted.emplace_back(static_cast<float>((i * 37) % 99) - 49.0f, static_cast<float>((i * 53) % 97) - 48.0f, static_cast<float>(i));
+        EXPECT_TRUE(tree->insert(inserted.back()));
+    }
+    for (int k = 0; k < 10; ++k) EXPECT_TRUE(tree->insert(Point(-3.0f, 4.0f, 1.0f)));  // Duplicates reach the overflow list
+
+    EXPECT_FALSE(tree->remove(Point(0.25f, 0.25f)));  // Not stored
+    EXPECT_FALSE(tree->move(Point(0.25f, 0.25f), Point(1.0f, 1.0f)));
+    EXPECT_FALSE(tree->move(inserted[0], Point(80.0f, 0.0f)));  // Outside the root, nothing changes
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, 610);
+
+    for (int k = 0; k < 10; ++k) EXPECT_TRUE(tree->remove(Point(-3.0f, 4.0f)));
+    EXPECT_FALSE(tree->remove(Point(-3.0f, 4.0f)));
+
+    // Move every other point onto a diagonal, then check range counts and payload sums against a scan
+    std::vector<Point> expected;
+    for (size_t i = 0; i < inserted.size(); ++i) {
+        if (i % 2 == 0) {
+            const Point to(static_cast<float>(i % 90) - 45.0f + 0.5f, static_cast<float>(i % 90) - 45.0f + 0.5f, inserted[i].payload);
+            EXPECT_TRUE(tree->move(inserted[i], to));
+            expected.push_back(to);
+        } else {
+            expected.push_back(inserted[i]);
+        }
+    }
+    const Rect range(-10.0f, 5.0f, 22.0f, 17.0f);
+    PayloadAggregate scan;
+    for (const Point &p : expected) {
+        if (range.contains(p)) scan.add(p);
+    }
+    const PayloadAggregate result = tree->aggregate(range);
+    EXPECT_EQ(result.count, scan.count);
+    EXPECT_EQ(result.sum, scan.sum);
+
+    // Removing everything leaves an undivided, empty root
+    for (const Point &p : expected) EXPECT_TRUE(tree->remove(p));
+    EXPECT_FALSE(tree->isDivided());
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, 0);
+}
+
+// Test a moved point keeps its timestamp
+TEST_F(QuadTreeTest, MoveKeepsTimestamp) {
+    EXPECT_TRUE(tree->insert(Point(1.0f, 1.0f), 5.0));
+    EXPECT_TRUE(tree->insert(Point(2.0f, 2.0f), 50.0));
+    EXPECT_TRUE(tree->move(Point(1.0f, 1.0f), Point(-20.0f, 30.0f)));
+
+    size_t removed = 0;
+    EXPECT_TRUE(tree->expireOlderThan(10.0, std::chrono::microseconds::max(), removed));
+    EXPECT_EQ(removed, 1u);
+    std::vector<Point> left;
+    tree->queryRange(tree->getBoundary(), [&](const Point &p) { left.push_back(p); });
+    EXPECT_EQ(left, std::vector<Point>{Point(2.0f, 2.0f)});
+}
+
+// Test warm-started KNN along a trajectory, seeded with the previous step's result, against cold searches
+TEST_F(QuadTreeTest, NearestNeighborsSeeded) {
+    for (int i = 0; i < 800; ++i) {
+        EXPECT_TRUE(tree->insert(Point(static_cast<float>((i * 37) % 99) - 49.0f, static_cast<float>((i * 53) % 97) - 48.0f)));
+    }
+    for (int k = 0; k < 6; ++k) EXPECT_TRUE(tree->insert(Point(5.0f, 5.0f))); // Duplicates tie at the bound
+
+    std::array<Point, 8> previous, seeded, cold;
+    Point target(-40.0f, -30.0f);
+    ASSERT_EQ(tree->nearestNeighbors<8>(target, previous), 8u);
+    for (int step = 0; step < 60; ++step) {
+        target = Point(target.x + 1.25f, target.y + 0.75f);
+        ASSERT_EQ(tree->nearestNeighborsSeeded<8>(target, previous, seeded), 8u);
+        ASSERT_EQ(tree->nearestNeighbors<8>(target, cold), 8u);
+        for (size_t i = 0; i < cold.size(); ++i) EXPECT_EQ(distanceSquared(target, seeded[i]), distanceSquared(target, cold[i]));
+        previous = seeded;
+    }
+
+    // Seeds that bound too tightly, because they are not stored, fall back to a cold search
+    const std::array<Point, 8> stale = { Point(5.1f, 5.0f), Point(5.0f, 5.1f), Point(4.9f, 5.0f), Point(5.0f, 4.9f),
+                                         Point(5.1f, 5.1f), Point(4.9f, 4.9f), Point(5.1f, 4.9f), Point(4.9f, 5.1f) };
+    ASSERT_EQ(tree->nearestNeighborsSeeded<8>(Point(5.0f, 5.0f), stale, seeded), 8u);
+    ASSERT_EQ(tree->nearestNeighbors<8>(Point(5.0f, 5.0f), cold), 8u);
+    for (size_t i = 0; i < cold.size(); ++i) EXPECT_EQ(distanceSquared(Point(5.0f, 5.0f), seeded[i]), distanceSquared(Point(5.0f, 5.0f), cold[i]));
+
+    // Too few seeds, and a tree holding fewer than N points
+    EXPECT_EQ(tree->nearestNeighborsSeeded<8>(target, std::span<const Point>(), seeded), 8u);
+    QuadTree small(Rect(0.0f, 0.0f, 10.0f, 10.0f));
+    EXPECT_TRUE(small.insert(Point(1.0f, 1.0f)));
+    EXPECT_TRUE(small.insert(Point(-2.0f, 3.0f)));
+    EXPECT_EQ(small.nearestNeighborsSeeded<8>(Point(0.0f, 0.0f), previous, seeded), 2u);
+    EXPECT_EQ(seeded[0], Point(1.0f, 1.0f));
+}
+
+// Test local KNN, moves and removes started from leaf handles against searches from the root
+TEST_F(QuadTreeTest, LeafHandles) {
+    std::vector<Point> entities;
+    std::vector<QuadTree::LeafHandle> leaves;
+    for (int i = 0; i < 700; ++i) {
+        entities.emplace_back(static_cast<float>((i * 37) % 99) - 49.0f, static_cast<float>((i * 53) % 97) - 48.0f, static_cast<float>(i));
+        leaves.emplace_back();
+        ASSERT_TRUE(tree->insert(entities.back(), leaves.back()));
+    }
+    EXPECT_FALSE(tree->insert(Point(60.0f, 0.0f), leaves.back())); // Outside the root
+    EXPECT_FALSE(tree->remove(Point(0.25f, 0.25f), leaves[0])); // Not stored
+
+    QuadTree::LeafHandle located;
+    EXPECT_FALSE(tree->locate(Point(0.0f, -55.0f), located));
+    ASSERT_TRUE(tree->locate(entities[3], located));
+
+    auto expectSameNeighbors = [&](const Point &target, const QuadTree::LeafHandle &leaf) {
+        std::array<Point, 8> local, cold;
+        ASSERT_EQ(tree->nearestNeighbors<8>(target, leaf, local), 8u);
+        ASSERT_EQ(tree->nearestNeighbors<8>(target, cold), 8u);
+        for (size_t k = 0; k < cold.size(); ++k) EXPECT_EQ(distanceSquared(target, local[k]), distanceSquared(target, cold[k]));
+    };
+    for (size_t i = 0; i < entities.size(); i += 7) expectSameNeighbors(entities[i], leaves[i]);
+    expectSameNeighbors(entities[3], located);
+
+    // Small moves keep every handle current, and the summaries agree with a scan
+    for (size_t i = 0; i < entities.size(); ++i) {
+        const Point to(std::clamp(entities[i].x + 0.75f, -50.0f, 50.0f), std::clamp(entities[i].y - 0.5f, -50.0f, 50.0f), entities[i].payload);
+        ASSERT_TRUE(tree->move(entities[i], to, leaves[i]));
+        entities[i] = to;
+    }
+    EXPECT_FALSE(tree->move(entities[0], Point(0.0f, 70.0f), leaves[0])); // Outside the root, nothing changes
+    for (size_t i = 0; i < entities.size(); i += 5) expectSameNeighbors(entities[i], leaves[i]);
+    PayloadAggregate scan;
+    for (const Point &p : entities) scan.add(p);
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, scan.count);
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).sum, scan.sum);
+
+    // Renumbering the arena and merging leaves away leaves stale handles, which still give exact results
+    tree->optimize();
+    for (size_t i = 0; i < entities.size(); i += 5) expectSameNeighbors(entities[i], leaves[i]);
+    for (size_t i = 0; i + 10 < entities.size(); ++i) ASSERT_TRUE(tree->remove(entities[i], leaves[i]));
+    entities.erase(entities.begin(), entities.end() - 10);
+    leaves.erase(leaves.begin(), leaves.end() - 10);
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, 10);
+    for (size_t i = 0; i < entities.size(); ++i) expectSameNeighbors(entities[i], leaves[i]);
+    expectSameNeighbors(Point(0.0f, 0.0f), QuadTree::LeafHandle());
+}
+
+// Test that handles survive the root growing around them
+TEST_F(QuadTreeTest, LeafHandlesGrowable) {
+    QuadTree growing(Rect(0.0f, 0.0f, 1.0f, 1.0f), true);
+    std::vector<Point> entities;
+    std::vector<QuadTree::LeafHandle> leaves;
+    for (int i = 0; i < 300; ++i) {
+        entities.emplace_back(static_cast<float>(i % 20) * 3.0f, static_cast<float>(i / 20) * -2.5f);
+        leaves.emplace_back();
+        ASSERT_TRUE(growing.insert(entities.back(), leaves.back()));
+    }
+    std::array<Point, 6> local, cold;
+    for (size_t i = 0; i < entities.size(); i += 3) {
+        ASSERT_EQ(growing.nearestNeighbors<6>(entities[i], leaves[i], local), 6u);
+        ASSERT_EQ(growing.nearestNeighbors<6>(entities[i], cold), 6u);
+        for (size_t k = 0; k < cold.size(); ++k) EXPECT_EQ(distanceSquared(entities[i], local[k]), distanceSquared(entities[i], cold[k]));
+    }
+    for (size_t i = 0; i < entities.size(); ++i) EXPECT_TRUE(growing.remove(entities[i], leaves[i]));
+    EXPECT_FALSE(growing.isDivided());
+}
+
+// Test expiring timestamped points removes exactly the stale ones and collapses emptied nodes
+TEST_F(QuadTreeTest, ExpireOlderThan) {
+    std::vector<std::pair<Point, double>> inserted;
+    for (int i = 0; i < 1200; ++i) {
+        const Point p(static_cast<float>((i * 37) % 99) - 49.0f, static_cast<float>((i * 53) % 97) - 48.0f, static_cast<float>(i));
+        inserted.emplace_back(p, static_cast<double>(i % 100));
+        EXPECT_TRUE(tree->insert(p, inserted.back().second));
+    }
+    EXPECT_TRUE(tree->insert(Point(1.5f, 1.5f, 7.0f)));  // Untimed, never expires
+    for (int k = 0; k < 10; ++k) tree->insert(Point(-3.0f, 4.0f, 1.0f), 5.0);  // Duplicates reach the overflow list
+
+    size_t removed = 0;
+    EXPECT_TRUE(tree->expireOlderThan(60.0, std::chrono::microseconds::max(), removed));
+    EXPECT_EQ(removed, 720u + 10u);
+
+    long long expected = 1;
+    double sum = 7.0;
+    for (const auto &[p, stamp] : inserted) {
+        if (stamp >= 60.0) {
+            ++expected;
+            sum += static_cast<double>(p.payload);
+        }
+    }
+    const PayloadAggregate all = tree->aggregate(tree->getBoundary());
+    EXPECT_EQ(all.count, expected);
+    EXPECT_EQ(all.sum, sum);
+
+    int stale = 0;
+    tree->queryRange(tree->getBoundary(), [&](const Point &p) { stale += static_cast<int>(p.payload) % 100 < 60 && p.payload != 7.0f; });
+    EXPECT_EQ(stale, 0);
+
+    // A second sweep with the same cutoff has nothing left to do
+    EXPECT_TRUE(tree->expireOlderThan(60.0, std::chrono::microseconds::max(), removed));
+    EXPECT_EQ(removed, 0u);
+
+    // Expiring everything timed leaves the untimed point in an undivided root
+    EXPECT_TRUE(tree->expireOlderThan(1000.0, std::chrono::microseconds::max(), removed));
+    EXPECT_FALSE(tree->isDivided());
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, 1);
+
+    // Released nodes are reused by later inserts
+    for (const auto &[p, stamp] : inserted) tree->insert(p, stamp + 1000.0);
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, static_cast<long long>(inserted.size()) + 1);
+}
+
+// Test a zero budget still makes progress on every call
+TEST_F(QuadTreeTest, ExpireWithinBudget) {
+    for (int i = 0; i < 2000; ++i) {
+        tree->insert(Point(static_cast<float>((i * 41) % 100) - 50.0f, static_cast<float>((i * 29) % 100) - 50.0f), 1.0);
+    }
+    tree->optimize();  // Stamps follow the relayout
+
+    size_t total = 0, removed = 0;
+    int calls = 0;
+    while (!tree->expireOlderThan(2.0, std::chrono::microseconds(0), removed)) {
+        total += removed;
+        ASSERT_LT(++calls, 10000);
+    }
+    total += removed;
+    EXPECT_EQ(total, 2000u);
+    EXPECT_GT(calls, 1);
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, 0);
+}
+
+// Test queries can ignore points that are stale but not yet swept
+TEST_F(QuadTreeTest, IgnoreOlderThan) {
+    tree->insert(Point(1.0f, 1.0f), 10.0);
+    tree->insert(Point(2.0f, 2.0f), 50.0);
+    tree->insert(Point(3.0f, 3.0f));  // Untimed
+    for (int i = 0; i < 20; ++i) tree->insert(Point(-40.0f + static_cast<float>(i), 30.0f), 100.0);
+
+    tree->ignoreOlderThan(20.0);
+    std::array<Point, 1> nearest;
+    float maxDist = 0.0f;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    std::vector<std::pair<float, Point>> nearestHeap;
+    tree->nearestNeighbors<1>(Point(0.0f, 0.0f), nearest, maxDist, nodeQueue, nearestHeap);
+    EXPECT_EQ(nearest[0], Point(2.0f, 2.0f));
+
+    int hits = 0;
+    tree->queryRange(Rect(0.0f, 0.0f, 50.0f, 50.0f), [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 22);
+
+    tree->ignoreOlderThan(std::numeric_limits<double>::lowest());
+    nearestHeap.clear();
+    tree->nearestNeighbors<1>(Point(0.0f, 0.0f), nearest, maxDist, nodeQueue, nearestHeap);
+    EXPECT_EQ(nearest[0], Point(1.0f, 1.0f));
+}
+
+// Fill tree with points along y = 0 and duplicates at (5, 5) that reach an overflow list, alternately stamped
+// before and after 20; hiding the stale ones leaves the line points at odd i and six of the duplicates
+static void insertAged(QuadTree &tree) {
+    for (int i = 0; i <= 20; ++i) tree.insert(Point(-40.0f + 4.0f * static_cast<float>(i), 0.0f), i % 2 ? 100.0 : 10.0);
+    for (int i = 0; i < 12; ++i) tree.insert(Point(5.0f, 5.0f), i % 2 ? 100.0 : 10.0);
+    tree.ignoreOlderThan(20.0);
+}
+
+// Test the incremental iterator skips points hidden by ignoreOlderThan
+TEST_F(QuadTreeTest, IgnoreOlderThanIterator) {
+    insertAged(*tree);
+    NearestNeighborIterator it(*tree, Point(-50.0f, 0.0f));
+    Point next;
+    ASSERT_TRUE(it.next(next));
+    EXPECT_EQ(next, Point(-36.0f, 0.0f));
+    int visited = 1;
+    while (it.next(next)) ++visited;
+    EXPECT_EQ(visited, 16);
+}
+
+// Test raycasts pass through points hidden by ignoreOlderThan
+TEST_F(QuadTreeTest, IgnoreOlderThanRaycast) {
+    insertAged(*tree);
+    RayHit hit;
+    ASSERT_TRUE(tree->raycast(Point(-50.0f, 0.0f), Point(1.0f, 0.0f), 100.0f, 0.5f, hit));
+    EXPECT_EQ(hit.point, Point(-36.0f, 0.0f));
+    ASSERT_TRUE(tree->raycast(Point(5.0f, -1.0f), Point(0.0f, 1.0f), 100.0f, 0.5f, hit));
+    EXPECT_EQ(hit.point, Point(5.0f, 5.0f));
+    EXPECT_FALSE(tree->raycast(Point(-40.0f, 10.0f), Point(0.0f, -1.0f), 15.0f, 0.5f, hit)); // Only a stale point on the way
+}
+
+// Test segment queries skip points hidden by ignoreOlderThan
+TEST_F(QuadTreeTest, IgnoreOlderThanSegment) {
+    insertAged(*tree);
+    int hits = 0;
+    tree->querySegment(Point(-50.0f, 0.0f), Point(50.0f, 0.0f), 0.5f, [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 10);
+    hits = 0;
+    tree->querySegment(Point(0.0f, 5.0f), Point(10.0f, 5.0f), 0.5f, [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 6);
+}
+
+// Test polygon queries skip hidden points in straddling leaves and in nodes wholly inside the polygon
+TEST_F(QuadTreeTest, IgnoreOlderThanPolygon) {
+    insertAged(*tree);
+    const std::vector<Point> everything = { Point(-60.0f, -60.0f), Point(60.0f, -60.0f), Point(60.0f, 60.0f), Point(-60.0f, 60.0f) };
+    int hits = 0;
+    tree->queryPolygon(everything, [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 16);
+
+    const std::vector<Point> triangle = { Point(-41.0f, -1.0f), Point(-31.0f, -1.0f), Point(-41.0f, 9.0f) };
+    hits = 0;
+    tree->queryPolygon(triangle, [&](const Point &) { ++hits; });
+    EXPECT_EQ(hits, 1);  // (-36, 0); (-40, 0) is stale
+}
+
+// Test joins skip points hidden by ignoreOlderThan on either side
+TEST_F(QuadTreeTest, IgnoreOlderThanJoin) {
+    insertAged(*tree);
+    QuadTree other(Rect(0.0f, 0.0f, 50.0f, 50.0f));
+    insertAged(other);
+    int pairs = 0;
+    tree->joinWithin(other, 0.5f, [&](const Point &, const Point &) { ++pairs; });
+    EXPECT_EQ(pairs, 10 + 6 * 6);
+
+    other.ignoreOlderThan(std::numeric_limits<double>::lowest());
+    pairs = 0;
+    tree->joinWithin(other, 0.5f, [&](const Point &, const Point &) { ++pairs; });
+    EXPECT_EQ(pairs, 10 + 6 * 12);
+}
+
+// Test self-joins skip points hidden by ignoreOlderThan
+TEST_F(QuadTreeTest, IgnoreOlderThanPairs) {
+    insertAged(*tree);
+    int pairs = 0;
+    tree->forEachPairWithin(0.5f, [&](const Point &a, const Point &b) {
+        EXPECT_EQ(a, b);
+        ++pairs;
+    });
+    EXPECT_EQ(pairs, 6 * 5 / 2);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,114 @@
+#include "ShardedQuadTree.hpp"
+
+#include <algorithm>
+
+// Constructor for the ShardedQuadTree, creates one empty QuadTree per grid cell
+ShardedQuadTree::ShardedQuadTree(const Rect &world, const int columns, const int rows)
+    : world(world), columns(std::max(1, columns)), rows(std::max(1, rows)),
+      cellWidth(2 * world.w / static_cast<float>(this->columns)), cellHeight(2 * world.h / static_cast<float>(this->rows)) {
+    // Grid lines, with the outermost ones taken from the world itself
+    auto gridLines = [](const float low, const float high, const float step, const int count) {
+        std::vector<float> lines(static_cast<size_t>(count) + 1);
+        for (int i = 0; i < count; ++i) lines[static_cast<size_t>(i)] = low + static_cast<float>(i) * step;
+        lines.front() = low;
+        lines.back() = high;
+        return lines;
+    };
+    const std::vector<float> xs = gridLines(world.x - world.w, world.x + world.w, cellWidth, this->columns);
+    const std::vector<float> ys = gridLines(world.y - world.h, world.y + world.h, cellHeight, this->rows);
+
+    shards.reserve(static_cast<size_t>(this->columns) * static_cast<size_t>(this->rows));
+    for (size_t row = 0; row + 1 < ys.size(); ++row) {
+        for (size_t column = 0; column + 1 < xs.size(); ++column) {
+            shards.push_back(std::make_unique<Shard>(rectBetween(xs[column], xs[column + 1], ys[row], ys[row + 1])));
+        }
+    }
+}
+
+const Rect &ShardedQuadTree::getBoundary() const {
+    return world;
+}
+
+int ShardedQuadTree::shardCount() const {
+    return static_cast<int>(shards.size());
+}
+
+int ShardedQuadTree::size() const {
+    int count = 0;
+    for (const auto &shard : shards) {
+        std::shared_lock lock(shard->mutex);
+        count += static_cast<int>(shard->tree.aggregate(shard->boundary).count); // Answered by the root summary
+    }
+    return count;
+}
+
+// Finds the grid cell from the coordinates, then lets the shard boundaries settle points on a shared edge
+int ShardedQuadTree::shardIndex(const Point &point) const {
+    if (!world.contains(point)) return -1;
+
+    int column = std::clamp(static_cast<int>((point.x - (world.x - world.w)) / cellWidth), 0, columns - 1);
+    int row = std::clamp(static_cast<int>((point.y - (world.y - world.h)) / cellHeight), 0, rows - 1);
+
+    // The division can round a point just across an edge; step back into the cell whose boundary holds it
+    const Rect &cell = shards[static_cast<size_t>(row * columns + column)]->boundary;
+    if (point.x < cell.x - cell.w && column > 0) --column;
+    else if (point.x > cell.x + cell.w && column < columns - 1) ++column;
+    if (point.y < cell.y - cell.h && row > 0) --row;
+    else if (point.y > cell.y + cell.h && row < rows - 1) ++row;
+    return row * columns + column;
+}
+
+bool ShardedQuadTree::insert(const Point &point) {
+    const int index = shardIndex(point);
+    if (index < 0) return false;
+
+    Shard &shard = *shards[static_cast<size_t>(index)];
+    std::unique_lock lock(shard.mutex);
+    return shard.tree.insert(point);
+}
+
+// Counting sort of the batch by shard, then one locked QuadTree::insertBatch per shard
+size_t ShardedQuadTree::insertBatch(std::span<Point> batch) {
+    std::vector<int> owner(batch.size());
+    std::vector<size_t> offsets(shards.size() + 1, 0);
+    size_t accepted = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        owner[i] = shardIndex(batch[i]);
+        if (owner[i] >= 0) {
+            ++offsets[static_cast<size_t>(owner[i]) + 1];
+            ++accepted;
+        }
+    }
+    for (size_t s = 0; s < shards.size(); ++s) {
+        offsets[s + 1] += offsets[s];
+    }
+
+    // Points outside the world go behind all shard groups
+    std::vector<Point> sorted(batch.begin(), batch.end());
+    std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+    size_t rejected = accepted;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const size_t slot = owner[i] >= 0 ? cursor[static_cast<size_t>(owner[i])]++ : rejected++;
+        sorted[slot] = batch[i];
+    }
+    std::ranges::copy(sorted, batch.begin());
+
+    size_t inserted = 0;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (offsets[s] == offsets[s + 1]) continue;
+        Shard &shard = *shards[s];
+        std::unique_lock lock(shard.mutex);
+        inserted += shard.tree.insertBatch(batch.subspan(offsets[s], offsets[s + 1] - offsets[s]));
+    }
+    return inserted;
+}
+
+PayloadAggregate ShardedQuadTree::aggregate(const Rect &range) const {
+    PayloadAggregate result;
+    for (const auto &shard : shards) {
+        if (!shard->boundary.intersects(range)) continue;
+        std::shared_lock lock(shard->mutex);
+        result.merge(shard->tree.aggregate(range));
+    }
+    return result;
+}
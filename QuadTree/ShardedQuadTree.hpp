@@ -0,0 +1,61 @@
+#ifndef SHARDEDQUADTREE_H
+#define SHARDEDQUADTREE_H
+
+#include "QuadTree.hpp"
+
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+// A world rectangle split into a columns x rows grid of independent QuadTree shards, each behind its own lock.
+// A point is routed to its shard by coordinate, so writers in different shards never contend and ingest
+// throughput grows with the shard count. Queries take a shared lock on one shard at a time and merge results.
+class ShardedQuadTree {
+    struct Shard {
+        Rect boundary; // Cell of the grid this shard owns, fixed for its lifetime
+        mutable std::shared_mutex mutex; // Exclusive for inserts, shared for queries
+        QuadTree tree;
+
+        explicit Shard(const Rect &boundary) : boundary(boundary), tree(boundary) {}
+    };
+
+    Rect world; // The area covered by all shards together
+    int columns; // Number of shards along x
+    int rows; // Number of shards along y
+    float cellWidth; // Full width of one shard
+    float cellHeight; // Full height of one shard
+    std::vector<std::unique_ptr<Shard>> shards; // Row-major, row 0 at the top (smallest y)
+
+    [[nodiscard]] int shardIndex(const Point &point) const; // Shard owning point, -1 if it is outside the world
+
+public:
+    // Constructor splitting world into columns x rows shards (each at least 1)
+    ShardedQuadTree(const Rect &world, int columns, int rows);
+
+    [[nodiscard]] const Rect &getBoundary() const; // The area covered by all shards
+    [[nodiscard]] int shardCount() const;
+    [[nodiscard]] int size() const; // Number of stored points
+
+    bool insert(const Point &point); // Insert into the shard owning point; false outside the world
+
+    // Insert a batch, grouped by shard so every shard is locked once and fed through QuadTree::insertBatch.
+    // The batch is reordered; returns the number of points inserted.
+    size_t insertBatch(std::span<Point> batch);
+
+    // Count, sum, min and max of the payloads inside range, merged over the shards it overlaps
+    [[nodiscard]] PayloadAggregate aggregate(const Rect &range) const;
+
+    // Visit every point inside range (edges included), shard by shard
+    template<typename Visitor>
+    void queryRange(const Rect &range, Visitor &&visitor) const;
+
+    // The N nearest points to target, nearest first, skipping target itself once like QuadTree::nearestNeighbors.
+    // Shards are visited in order of their distance from target, and a shard is only entered while it can still
+    // hold something closer than the current N-th neighbour. Returns the number of points found.
+    template<size_t N>
+    size_t nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const;
+};
+
+#include "ShardedQuadTree.tpp"
+
+#endif //SHARDEDQUADTREE_H
@@ -0,0 +1,58 @@
+#ifndef SHARDEDQUADTREE_TPP
+#define SHARDEDQUADTREE_TPP
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+template<typename Visitor>
+void ShardedQuadTree::queryRange(const Rect &range, Visitor &&visitor) const {
+    for (const auto &shard : shards) {
+        if (!shard->boundary.intersects(range)) continue;
+        std::shared_lock lock(shard->mutex);
+        shard->tree.queryRange(range, visitor);
+    }
+}
+
+template<size_t N>
+size_t ShardedQuadTree::nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const {
+    // Shards ordered by the distance from target to their cell
+    std::vector<std::pair<float, int>> order;
+    order.reserve(shards.size());
+    for (size_t i = 0; i < shards.size(); ++i) {
+        order.emplace_back(distanceSquared(target, shards[i]->boundary), static_cast<int>(i));
+    }
+    std::ranges::sort(order);
+
+    // The N closest candidates seen so far, kept by offerNearest
+    std::vector<std::pair<float, Point>> nearestHeap;
+    nearestHeap.reserve(N);
+    float maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false;
+
+    for (const auto &[cellDistance, index] : order) {
+        // Every shard left is at least this far away, so none can improve a full heap
+        if (nearestHeap.size() == N && cellDistance >= maxDist) break;
+
+        const Shard &shard = *shards[index];
+        std::shared_lock lock(shard.mutex);
+        NearestNeighborIterator it(shard.tree, target);
+        Point candidate;
+        float dist;
+        while (it.next(candidate, dist)) {
+            if (nearestHeap.size() == N && dist >= maxDist) break; // The rest of this shard is farther still
+            if (!targetSkipped && candidate == target) {
+                targetSkipped = true;
+                continue;
+            }
+            offerNearest<N>(nearestHeap, dist, candidate, maxDist);
+        }
+    }
+
+    if (nearestHeap.size() < N) std::ranges::make_heap(nearestHeap); // Fewer than N never formed a heap
+    const size_t found = drainNearest(nearestHeap, nearest); // Farthest first
+    std::reverse(nearest.begin(), nearest.begin() + static_cast<std::ptrdiff_t>(found));
+    return found;
+}
+
+#endif // SHARDEDQUADTREE_TPP
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "ShardedQuadTree.hpp"
+
+#include <thread>
+
+class ShardedQuadTreeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create a 4x3 grid of shards covering a 120x90 area centered at (0,0)
+        tree = std::make_unique<ShardedQuadTree>(Rect(0.0f, 0.0f, 60.0f, 45.0f), 4, 3);
+    }
+
+    // Fill the tree with a lattice whose points land on shard edges as well as inside shards
+    std::vector<Point> insertLattice() {
+        std::vector<Point> inserted;
+        for (int i = -60; i <= 60; i += 3) {
+            for (int j = -45; j <= 45; j += 5) {
+                inserted.emplace_back(static_cast<float>(i), static_cast<float>(j), static_cast<float>(i + j));
+                EXPECT_TRUE(tree->insert(inserted.back()));
+            }
+        }
+        return inserted;
+    }
+
+    std::unique_ptr<ShardedQuadTree> tree;
+};
+
+// Test routing points to shards, including world and shard edges
+TEST_F(ShardedQuadTreeTest, InsertRouting) {
+    EXPECT_EQ(tree->shardCount(), 12);
+    EXPECT_TRUE(tree->insert(Point(0.0f, 0.0f)));     // Corner shared by four shards
+    EXPECT_TRUE(tree->insert(Point(-30.0f, 15.0f)));  // Edge shared by two shards
+    EXPECT_TRUE(tree->insert(Point(60.0f, 45.0f)));   // World corner, edges included
+    EXPECT_FALSE(tree->insert(Point(60.5f, 0.0f)));   // Outside the world
+    EXPECT_EQ(tree->size(), 3);
+
+    // Every point is stored exactly once
+    EXPECT_EQ(tree->aggregate(tree->getBoundary()).count, 3);
+    EXPECT_EQ(tree->aggregate(Rect(0.0f, 0.0f, 0.0f, 0.0f)).count, 1);
+}
+
+// Test range queries and aggregates merge across shards
+TEST_F(ShardedQuadTreeTest, QueryRange) {
+    const std::vector<Point> inserted = insertLattice();
+    const Rect range(-7.0f, 4.0f, 31.0f, 20.0f);
+
+    std::vector<Point> found;
+    tree->queryRange(range, [&](const Point &p) { found.push_back(p); });
+
+    std::vector<Point> expected;
+    double sum = 0.0;
+    for (const Point &p : inserted) {
+        if (range.contains(p)) {
+            expected.push_back(p);
+            sum += static_cast<double>(p.payload);
+        }
+    }
+    std::sort(found.begin(), found.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(found, expected);
+
+    const PayloadAggregate aggregate = tree->aggregate(range);
+    EXPECT_EQ(aggregate.count, static_cast<long long>(expected.size()));
+    EXPECT_EQ(aggregate.sum, sum);
+}
+
+// Test nearest neighbors across shard boundaries against a brute-force scan
+TEST_F(ShardedQuadTreeTest, NearestNeighbors) {
+    const std::vector<Point> inserted = insertLattice();
+
+    for (const Point &target : { Point(0.5f, 0.5f), Point(-30.0f, 15.0f), Point(59.0f, -44.0f), Point(-14.0f, 31.0f) }) {
+        std::vector<float> distances;
+        bool skipped = false;
+        for (const Point &p : inserted) {
+            if (!skipped && p == target) {
+                skipped = true;
+                continue;
+            }
+            distances.push_back(distanceSquared(target, p));
+        }
+        std::sort(distances.begin(), distances.end());
+
+        std::array<Point, 12> nearest;
+        ASSERT_EQ(tree->nearestNeighbors<12>(target, nearest), nearest.size());
+        for (size_t i = 0; i < nearest.size(); ++i) {
+            EXPECT_EQ(distanceSquared(target, nearest[i]), distances[i]);
+        }
+    }
+}
+
+// Test nearest neighbors with fewer points than requested
+TEST_F(ShardedQuadTreeTest, NearestNeighborsFewPoints) {
+    tree->insert(Point(-50.0f, -40.0f));
+    tree->insert(Point(50.0f, 40.0f));
+
+    std::array<Point, 5> nearest;
+    ASSERT_EQ(tree->nearestNeighbors<5>(Point(45.0f, 40.0f), nearest), 2u);
+    EXPECT_EQ(nearest[0], Point(50.0f, 40.0f));
+    EXPECT_EQ(nearest[1], Point(-50.0f, -40.0f));
+}
+
+// Test concurrent inserts from several threads and batched inserts
+TEST_F(ShardedQuadTreeTest, ConcurrentAndBatchInsert) {
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 2000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                const float x = static_cast<float>((i * 31 + t * 7) % 120) - 60.0f;
+                const float y = static_cast<float>((i * 17 + t * 3) % 90) - 45.0f;
+                tree->insert(Point(x, y));
+            }
+        });
+    }
+    for (std::thread &worker : workers) worker.join();
+    EXPECT_EQ(tree->size(), THREADS * PER_THREAD);
+
+    std::vector<Point> batch;
+    for (int i = 0; i < 500; ++i) {
+        batch.emplace_back(static_cast<float>(i % 121) - 60.0f, static_cast<float>(i % 91) - 45.0f);
+    }
+    batch.emplace_back(100.0f, 0.0f);  // Outside the world
+    EXPECT_EQ(tree->insertBatch(batch), 500u);
+    EXPECT_EQ(batch.back(), Point(100.0f, 0.0f));  // Rejected points are moved to the back
+    EXPECT_EQ(tree->size(), THREADS * PER_THREAD + 500);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,22 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "QuadTree.hpp"
+
+#include <concepts>
+
+// The point index API shared by QuadTree, ShardedQuadTree and UniformGridIndex, so code and benchmarks can be
+// written once and run on whichever backend suits a dataset:
+//   insert(point)                  false if the point is outside the index
+//   queryRange(range, visitor)     visits every point inside range, edges included
+//   nearestNeighbors<N>(t, array)  the N nearest points to t, nearest first, skipping t itself once;
+//                                  returns how many were found
+template<typename Index>
+concept SpatialIndex = requires(Index &index, const Index &view, const Point &point, const Rect &range, std::array<Point, 8> &nearest) {
+    { index.insert(point) } -> std::same_as<bool>;
+    { view.getBoundary() } -> std::convertible_to<Rect>;
+    view.queryRange(range, [](const Point &) {});
+    { view.template nearestNeighbors<8>(point, nearest) } -> std::same_as<size_t>;
+};
+
+#endif //SPATIALINDEX_H
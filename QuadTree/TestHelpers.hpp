@@ -0,0 +1,27 @@
+#ifndef TESTHELPERS_H
+#define TESTHELPERS_H
+
+#include "QuadTree.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// Nearest-first squared distances of the N nearest points to target, skipping target once, as the KNN
+// searches do; the reference the nearest-neighbour tests of every index compare against
+template<size_t N>
+std::vector<float> bruteForce(const std::vector<Point> &points, const Point &target) {
+    std::vector<float> distances;
+    bool skipped = false;
+    for (const Point &p : points) {
+        if (!skipped && p == target) {
+            skipped = true;
+            continue;
+        }
+        distances.push_back(distanceSquared(target, p));
+    }
+    std::sort(distances.begin(), distances.end());
+    distances.resize(std::min(distances.size(), N));
+    return distances;
+}
+
+#endif //TESTHELPERS_H
@@ -0,0 +1,88 @@
+#include "UniformGridIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Constructor for the UniformGridIndex, allocating every cell's slots up front
+UniformGridIndex::UniformGridIndex(const Rect &boundary, const int columns, const int rows)
+    : boundary(boundary), columns(std::max(1, columns)), rows(std::max(1, rows)),
+      left(boundary.x - boundary.w), top(boundary.y - boundary.h),
+      cellWidth(2 * boundary.w / static_cast<float>(this->columns)), cellHeight(2 * boundary.h / static_cast<float>(this->rows)),
+      inverseCellWidth(static_cast<float>(this->columns) / (2 * boundary.w)), inverseCellHeight(static_cast<float>(this->rows) / (2 * boundary.h)) {
+    const size_t cells = static_cast<size_t>(this->columns) * static_cast<size_t>(this->rows);
+    slots.resize(cells * CELL_CAPACITY);
+    counts.assign(cells, 0);
+    overflowOf.assign(cells, -1);
+}
+
+void UniformGridIndex::resolutionFor(const Rect &boundary, const size_t expectedPoints, const float pointsPerCell, int &columns, int &rows) {
+    // Cells as close to square as the boundary's aspect ratio allows
+    const double cells = std::max(1.0, static_cast<double>(expectedPoints) / static_cast<double>(std::max(pointsPerCell, 0.01f)));
+    const double aspect = static_cast<double>(boundary.w) / static_cast<double>(std::max(boundary.h, std::numeric_limits<float>::min()));
+    columns = std::max(1, static_cast<int>(std::lround(std::sqrt(cells * aspect))));
+    rows = std::max(1, static_cast<int>(std::lround(cells / columns)));
+}
+
+const Rect &UniformGridIndex::getBoundary() const {
+    return boundary;
+}
+
+int UniformGridIndex::size() const {
+    return count;
+}
+
+int UniformGridIndex::columnCount() const {
+    return columns;
+}
+
+int UniformGridIndex::rowCount() const {
+    return rows;
+}
+
+float UniformGridIndex::columnEdge(const int column) const {
+    return column == columns ? boundary.x + boundary.w : left + static_cast<float>(column) * cellWidth;
+}
+
+float UniformGridIndex::rowEdge(const int row) const {
+    return row == rows ? boundary.y + boundary.h : top + static_cast<float>(row) * cellHeight;
+}
+
+// The multiplication can round a coordinate just across a grid line; the edges settle it, as in ShardedQuadTree
+int UniformGridIndex::columnOf(const float x) const {
+    int column = std::clamp(static_cast<int>((x - left) * inverseCellWidth), 0, columns - 1);
+    if (x < columnEdge(column) && column > 0) --column;
+    else if (x >= columnEdge(column + 1) && column < columns - 1) ++column;
+    return column;
+}
+
+int UniformGridIndex::rowOf(const float y) const {
+    int row = std::clamp(static_cast<int>((y - top) * inverseCellHeight), 0, rows - 1);
+    if (y < rowEdge(row) && row > 0) --row;
+    else if (y >= rowEdge(row + 1) && row < rows - 1) ++row;
+    return row;
+}
+
+float UniformGridIndex::distanceSquaredToCell(const Point &p, const int column, const int row) const {
+    const float dx = std::max({0.0f, columnEdge(column) - p.x, p.x - columnEdge(column + 1)});
+    const float dy = std::max({0.0f, rowEdge(row) - p.y, p.y - rowEdge(row + 1)});
+    return dx * dx + dy * dy;
+}
+
+bool UniformGridIndex::insert(const Point &point) {
+    if (!boundary.contains(point)) {
+        return false; // Point is outside the grid
+    }
+    const int cell = rowOf(point.y) * columns + columnOf(point.x);
+    const int stored = counts[cell]++;
+    if (stored < CELL_CAPACITY) {
+        slots[static_cast<size_t>(cell) * CELL_CAPACITY + static_cast<size_t>(stored)] = point;
+    } else {
+        if (overflowOf[cell] < 0) {
+            overflowOf[cell] = static_cast<int>(overflowPoints.size());
+            overflowPoints.emplace_back();
+        }
+        overflowPoints[overflowOf[cell]].push_back(point);
+    }
+    ++count;
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef UNIFORMGRIDINDEX_H
+#define UNIFORMGRIDINDEX_H
+
+#include "QuadTree.hpp"
+
+#include <vector>
+
+// Flat bucket grid over a fixed boundary, an alternative to QuadTree for dense, evenly spread data such as
+// a raster of integer coordinates. A point's cell is found by two multiplications instead of a descent, and
+// each cell keeps CELL_CAPACITY points inline in one contiguous array, so inserts touch a single cache line
+// and KNN scans the cells in rings around the target's cell, stopping once no unvisited cell can be closer.
+// Skewed data piles up in a few cells' overflow lists, where QuadTree keeps adapting.
+class UniformGridIndex {
+public:
+    static constexpr int CELL_CAPACITY = 4; // Points stored inline per cell, as many as a QuadTree leaf holds
+
+private:
+    Rect boundary;
+    int columns; // Number of cells along x
+    int rows; // Number of cells along y
+    float left, top; // Coordinates of the first grid lines
+    float cellWidth, cellHeight;
+    float inverseCellWidth, inverseCellHeight;
+
+    std::vector<Point> slots; // CELL_CAPACITY slots per cell, row-major, row 0 at the top (smallest y)
+    std::vector<int> counts; // Points per cell, including its overflow list
+    std::vector<int> overflowOf; // Index into overflowPoints per cell, -1 if none
+    std::vector<std::vector<Point>> overflowPoints; // Points beyond CELL_CAPACITY in crowded cells
+    int count = 0;
+
+    // Grid lines, with the last one taken from the boundary itself so the outer cells reach its edges
+    [[nodiscard]] float columnEdge(int column) const;
+    [[nodiscard]] float rowEdge(int row) const;
+
+    // Cell column or row of a coordinate, clamped to the grid; a coordinate on a grid line goes to the cell after it
+    [[nodiscard]] int columnOf(float x) const;
+    [[nodiscard]] int rowOf(float y) const;
+
+    // Squared distance from p to a cell, zero inside
+    [[nodiscard]] float distanceSquaredToCell(const Point &p, int column, int row) const;
+
+    template<typename Visitor>
+    void visitCell(int cell, Visitor &visitor) const; // Visit every point of one cell
+
+public:
+    // Constructor splitting boundary into columns x rows cells (each at least 1)
+    UniformGridIndex(const Rect &boundary, int columns, int rows);
+
+    // Columns and rows for a square-ish grid over boundary with about pointsPerCell of expectedPoints evenly
+    // spread points per cell
+    static void resolutionFor(const Rect &boundary, size_t expectedPoints, float pointsPerCell, int &columns, int &rows);
+
+    [[nodiscard]] const Rect &getBoundary() const; // The area covered by the grid
+    [[nodiscard]] int size() const; // Number of stored points
+    [[nodiscard]] int columnCount() const;
+    [[nodiscard]] int rowCount() const;
+
+    bool insert(const Point &point); // Insert a point; false if it is outside the boundary
+
+    // Visit every point inside range (edges included), cell by cell
+    template<typename Visitor>
+    void queryRange(const Rect &range, Visitor &&visitor) const;
+
+    // The N nearest points to target, nearest first, skipping target itself once like QuadTree::nearestNeighbors.
+    // Cells are scanned in square rings of growing radius around target's cell. Returns the number of points found.
+    template<size_t N>
+    size_t nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const;
+};
+
+#include "UniformGridIndex.tpp"
+
+#endif //UNIFORMGRIDINDEX_H
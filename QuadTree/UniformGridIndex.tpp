@@ -0,0 +1,91 @@
+#ifndef UNIFORMGRIDINDEX_TPP
+#define UNIFORMGRIDINDEX_TPP
+
+#include <algorithm>
+#include <limits>
+
+template<typename Visitor>
+void UniformGridIndex::visitCell(const int cell, Visitor &visitor) const {
+    const Point *cellSlots = &slots[static_cast<size_t>(cell) * CELL_CAPACITY];
+    const int stored = std::min(counts[cell], CELL_CAPACITY);
+    for (int i = 0; i < stored; ++i) visitor(cellSlots[i]);
+    if (overflowOf[cell] >= 0) {
+        for (const Point &p : overflowPoints[overflowOf[cell]]) visitor(p);
+    }
+}
+
+template<typename Visitor>
+void UniformGridIndex::queryRange(const Rect &range, Visitor &&visitor) const {
+    if (count == 0 || !boundary.intersects(range)) return;
+
+    auto test = [&](const Point &p) {
+        if (range.contains(p)) visitor(p);
+    };
+    const int lastColumn = columnOf(range.x + range.w);
+    const int lastRow = rowOf(range.y + range.h);
+    for (int row = rowOf(range.y - range.h); row <= lastRow; ++row) {
+        for (int column = columnOf(range.x - range.w); column <= lastColumn; ++column) {
+            visitCell(row * columns + column, test);
+        }
+    }
+}
+
+template<size_t N>
+size_t UniformGridIndex::nearestNeighbors(const Point &target, std::array<Point, N> &nearest) const {
+    // The N closest candidates seen so far, kept by offerNearest
+    thread_local std::vector<std::pair<float, Point>> nearestHeap;
+    nearestHeap.clear();
+    float maxDist = std::numeric_limits<float>::max(); // Nothing is pruned until N candidates are found
+    bool targetSkipped = false; // The query point itself is skipped once if it is stored in the grid
+
+    auto consider = [&](const Point &candidate) {
+        if (!targetSkipped && candidate == target) {
+            targetSkipped = true;
+            return;
+        }
+        offerNearest<N>(nearestHeap, distanceSquared(target, candidate), candidate, maxDist);
+    };
+    // Cells farther than the N-th neighbour found so far are skipped without reading their points
+    auto scan = [&](const int column, const int row) {
+        if (distanceSquaredToCell(target, column, row) > maxDist) return;
+        visitCell(row * columns + column, consider);
+    };
+
+    const int column = columnOf(target.x);
+    const int row = rowOf(target.y);
+    for (int ring = 0; count > 0; ++ring) {
+        const int firstColumn = column - ring, lastColumn = column + ring;
+        const int firstRow = row - ring, lastRow = row + ring;
+        if (ring == 0) {
+            scan(column, row);
+        } else {
+            // Top and bottom rows of the ring, then the columns on either side between them
+            for (int c = std::max(firstColumn, 0); c <= std::min(lastColumn, columns - 1); ++c) {
+                if (firstRow >= 0) scan(c, firstRow);
+                if (lastRow < rows) scan(c, lastRow);
+            }
+            for (int r = std::max(firstRow + 1, 0); r <= std::min(lastRow - 1, rows - 1); ++r) {
+                if (firstColumn >= 0) scan(firstColumn, r);
+                if (lastColumn < columns) scan(lastColumn, r);
+            }
+        }
+        if (firstColumn <= 0 && lastColumn >= columns - 1 && firstRow <= 0 && lastRow >= rows - 1) break; // Grid exhausted
+
+        // Every cell outside the rings so far lies beyond the nearest side of the square they cover
+        if (nearestHeap.size() == N) {
+            float escape = std::numeric_limits<float>::max();
+            if (firstColumn > 0) escape = std::min(escape, target.x - columnEdge(firstColumn));
+            if (lastColumn < columns - 1) escape = std::min(escape, columnEdge(lastColumn + 1) - target.x);
+            if (firstRow > 0) escape = std::min(escape, target.y - rowEdge(firstRow));
+            if (lastRow < rows - 1) escape = std::min(escape, rowEdge(lastRow + 1) - target.y);
+            if (escape > 0.0f && escape * escape > maxDist) break;
+        }
+    }
+
+    if (nearestHeap.size() < N) std::ranges::make_heap(nearestHeap); // Fewer than N never formed a heap
+    const size_t found = drainNearest(nearestHeap, nearest); // Farthest first
+    std::reverse(nearest.begin(), nearest.begin() + static_cast<std::ptrdiff_t>(found));
+    return found;
+}
+
+#endif // UNIFORMGRIDINDEX_TPP
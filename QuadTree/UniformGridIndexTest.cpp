@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "UniformGridIndex.hpp"
+#include "ShardedQuadTree.hpp"
+#include "SpatialIndex.hpp"
+#include "TestHelpers.hpp"
+
+static_assert(SpatialIndex<QuadTree>);
+static_assert(SpatialIndex<ShardedQuadTree>);
+static_assert(SpatialIndex<UniformGridIndex>);
+
+class UniformGridIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create a 7x5 grid covering a 100x100 area centered at (0,0); the cell sizes do not divide the lattice
+        grid = std::make_unique<UniformGridIndex>(Rect(0.0f, 0.0f, 50.0f, 50.0f), 7, 5);
+    }
+
+    // Fill the grid with a lattice reaching the boundary, a few duplicates and a crowded cell
+    std::vector<Point> insertPoints() {
+        std::vector<Point> inserted;
+        for (int i = -50; i <= 50; i += 5) {
+            for (int j = -50; j <= 50; j += 4) {
+                inserted.emplace_back(static_cast<float>(i), static_cast<float>(j), static_cast<float>(i * j));
+            }
+        }
+        for (int k = 0; k < 12; ++k) inserted.emplace_back(3.0f + static_cast<float>(k) / 16.0f, -7.0f, static_cast<float>(k));
+        for (int k = 0; k < 3; ++k) inserted.emplace_back(10.0f, 10.0f);
+        for (const Point &p : inserted) EXPECT_TRUE(grid->insert(p));
+        return inserted;
+    }
+
+    std::unique_ptr<UniformGridIndex> grid;
+};
+
+// Test inserting points inside, on the edges of and outside the grid
+TEST_F(UniformGridIndexTest, InsertPoint) {
+    EXPECT_TRUE(grid->insert(Point(10.0f, 10.0f)));
+    EXPECT_TRUE(grid->insert(Point(50.0f, -50.0f)));  // Corner, edges included
+    EXPECT_TRUE(grid->insert(Point(-50.0f, 50.0f)));
+    EXPECT_FALSE(grid->insert(Point(50.5f, 0.0f)));
+    EXPECT_EQ(grid->size(), 3);
+    EXPECT_EQ(grid->columnCount(), 7);
+    EXPECT_EQ(grid->rowCount(), 5);
+}
+
+// Test range queries against a brute-force scan, including ranges reaching past the grid
+TEST_F(UniformGridIndexTest, QueryRange) {
+    const std::vector<Point> inserted = insertPoints();
+    for (const Rect &range : { Rect(0.0f, 0.0f, 50.0f, 50.0f), Rect(3.5f, -7.0f, 1.0f, 0.5f), Rect(-40.0f, 45.0f, 20.0f, 20.0f),
+                               Rect(15.0f, 10.0f, 5.0f, 6.0f), Rect(90.0f, 0.0f, 10.0f, 10.0f) }) {
+        std::vector<Point> found, expected;
+        grid->queryRange(range, [&](const Point &p) { found.push_back(p); });
+        for (const Point &p : inserted) {
+            if (range.contains(p)) expected.push_back(p);
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+// Test nearest neighbors against a brute-force scan, nearest first
+TEST_F(UniformGridIndexTest, NearestNeighbors) {
+    const std::vector<Point> inserted = insertPoints();
+    std::array<Point, 10> nearest;
+    for (const Point &target : { Point(1.0f, 2.0f), Point(10.0f, 10.0f), Point(3.25f, -7.0f), Point(-50.0f, 50.0f),
+                                 Point(49.9f, -0.1f), Point(80.0f, 75.0f) }) {
+        const std::vector<float> expected = bruteForce<10>(inserted, target);
+        ASSERT_EQ(grid->nearestNeighbors<10>(target, nearest), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(distanceSquared(target, nearest[i]), expected[i]);
+        }
+    }
+}
+
+// Test asking for more neighbours than there are points
+TEST_F(UniformGridIndexTest, NearestNeighborsFewPoints) {
+    std::array<Point, 4> nearest;
+    EXPECT_EQ(grid->nearestNeighbors<4>(Point(0.0f, 0.0f), nearest), 0u);
+
+    EXPECT_TRUE(grid->insert(Point(-40.0f, -40.0f)));
+    EXPECT_TRUE(grid->insert(Point(40.0f, 40.0f)));
+    EXPECT_TRUE(grid->insert(Point(0.0f, 0.0f)));
+    EXPECT_EQ(grid->nearestNeighbors<4>(Point(0.0f, 0.0f), nearest), 2u);  // The target itself is skipped
+    EXPECT_EQ(grid->nearestNeighbors<4>(Point(30.0f, 30.0f), nearest), 3u);
+    EXPECT_EQ(nearest[0], Point(40.0f, 40.0f));
+    EXPECT_EQ(nearest[2], Point(-40.0f, -40.0f));
+}
+
+// Test the backends answer alike through the shared concept
+TEST_F(UniformGridIndexTest, MatchesQuadTree) {
+    QuadTree tree(grid->getBoundary());
+    int columns = 0, rows = 0;
+    UniformGridIndex::resolutionFor(grid->getBoundary(), 3000, 2.0f, columns, rows);
+    EXPECT_EQ(columns, 39);  // 1500 cells, as square as a square boundary allows
+    EXPECT_EQ(rows, 38);
+    UniformGridIndex sized(grid->getBoundary(), columns, rows);
+
+    auto fill = [](SpatialIndex auto &index) {
+        for (int i = 0; i < 3000; ++i) {
+            index.insert(Point(static_cast<float>((i * 37) % 101) - 50.0f, static_cast<float>((i * 61) % 89) - 44.0f, static_cast<float>(i)));
+        }
+    };
+    auto distances = [](const SpatialIndex auto &index, const Point &target) {
+        std::array<Point, 8> nearest;
+        std::vector<float> result;
+        const size_t found = index.template nearestNeighbors<8>(target, nearest);
+        for (size_t i = 0; i < found; ++i) result.push_back(distanceSquared(target, nearest[i]));
+        return result;
+    };
+    fill(tree);
+    fill(sized);
+    for (const Point &target : { Point(3.5f, -7.25f), Point(-13.0f, 0.0f), Point(49.0f, 44.0f) }) {
+        EXPECT_EQ(distances(tree, target), distances(sized, target));
+    }
+}
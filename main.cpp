@@ -1,28 +1,40 @@
 #include "QuadTree/QuadTree.hpp"
+#include "Benchmark/PerfCounter.hpp"
 #include <iostream>
 #include <chrono>
 #include <random>
 #include <queue>
+#include <cstdlib>
 
-int main() {
+// Usage: QuadTreeMain [prefetch distance]; every phase is timed with prefetching disabled and at that distance
+int main(const int argc, char **argv) {
     constexpr int MAP_SIZE = 3600;
     constexpr int NUM_QUERIES = 1000000
     ;
+    const int prefetchDistance = argc > 1 ? std::atoi(argv[1]) : QuadTree(Rect()).getPrefetchDistance();
 
     const Rect boundary(MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f, MAP_SIZE / 2.0f);
     QuadTree qt(boundary);
 
     // Measure insertion time
-    auto start = std::chrono::high_resolution_clock::now();
-    for (int x = 0; x < MAP_SIZE; ++x) {
-        for (int y = 0; y < MAP_SIZE; ++y) {
-            const float payload = static_cast<float>(x + y) / 2.0f;
-            qt.insert(Point(static_cast<float>(x), static_cast<float>(y), payload));
+    auto fill = [&](QuadTree &tree, const int distance) {
+        tree.setPrefetchDistance(distance);
+        const auto begin = std::chrono::high_resolution_clock::now();
+        for (int x = 0; x < MAP_SIZE; ++x) {
+            for (int y = 0; y < MAP_SIZE; ++y) {
+                const float payload = static_cast<float>(x + y) / 2.0f;
+                tree.insert(Point(static_cast<float>(x), static_cast<float>(y), payload));
+            }
         }
+        const auto finish = std::chrono::high_resolution_clock::now();
+        const std::chrono::duration<double> insert_time = finish - begin;
+        std::cout << "Insertion time (prefetch distance " << distance << "): " << insert_time.count() << " seconds\n";
+    };
+    {
+        QuadTree unprefetched(boundary);
+        fill(unprefetched, 0);
     }
-    auto end = std::chrono::high_resolution_clock::now();
-    const std::chrono::duration<double> insert_time = end - start;
-    std::cout << "Insertion time: " << insert_time.count() << " seconds\n";
+    fill(qt, prefetchDistance);
 
     // Setup random number generation for queries
     std::random_device rd;
@@ -30,30 +42,65 @@ int main() {
     auto gen = std::mt19937(sd);
     std::uniform_int_distribution dis(0, MAP_SIZE - 1);
 
+    // Draw the query targets up front so both runs below see the same sequence
+    std::vector<Point> targets;
+    targets.reserve(NUM_QUERIES);
+    for (int i = 0; i < NUM_QUERIES; ++i) {
+        targets.emplace_back(static_cast<float>(dis(gen)), static_cast<float>(dis(gen)));
+    }
+
     // Preallocate nearest neighbors array and heap
     std::array<Point, 8> nearest;
     float maxDist = std::numeric_limits<float>::max();
     std::vector<std::pair<float, Point>> nearestHeap;
     nearestHeap.reserve(8); // Reserve space for nearest neighbors heap
     std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> nodeQueue;
+    const PerfCounter llcMisses = PerfCounter::llcMisses();
+    const PerfCounter dtlbMisses = PerfCounter::dtlbMisses();
 
-    // Measure nearest neighbor search time
-    start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < NUM_QUERIES; ++i) {
-        Point target(static_cast<float>(dis(gen)), static_cast<float>(dis(gen)));
+    // Measure nearest neighbor search time, last-level cache misses and data TLB misses
+    auto runQueries = [&](const char *label, const int distance) {
+        qt.setPrefetchDistance(distance);
+        double checksum = 0.0;
+        llcMisses.start();
+        dtlbMisses.start();
+        const auto begin = std::chrono::high_resolution_clock::now();
+        for (const Point &target : targets) {
+            // Reset heap and queue for each query
+            nearestHeap.clear();
+            while (!nodeQueue.empty()) nodeQueue.pop();  // Clear the priority queue
 
-        // Reset heap and queue for each query
-        nearestHeap.clear();
-        while (!nodeQueue.empty()) nodeQueue.pop();  // Clear the priority queue
+            // Perform nearest neighbor search
+            qt.nearestNeighbors<8>(target, nearest, maxDist, nodeQueue, nearestHeap);
+            checksum += static_cast<double>(nearest[0].x + nearest[0].y);
+        }
+        const auto finish = std::chrono::high_resolution_clock::now();
+        const std::chrono::duration<double> nn_search_time = finish - begin;
 
-        // Perform nearest neighbor search
-        qt.nearestNeighbors<8>(target, nearest, maxDist, nodeQueue, nearestHeap);
-    }
-    end = std::chrono::high_resolution_clock::now();
-    const std::chrono::duration<double> nn_search_time = end - start;
+        std::cout << "[" << label << ", prefetch distance " << distance << "]\n";
+        std::cout << "Total nearest neighbor search time: " << nn_search_time.count() << " seconds\n";
+        std::cout << "Average time per search: " << (nn_search_time.count() / NUM_QUERIES) << " seconds\n";
+        llcMisses.report(std::cout, "LLC misses");
+        dtlbMisses.report(std::cout, "dTLB misses");
+        std::cout << "Result checksum: " << checksum << "\n";
+    };
+
+    runQueries("insertion order", 0);
+    runQueries("insertion order", prefetchDistance);
+
+    // Relayout the nodes and run the same queries again; the checksum must not change
+    const auto start = std::chrono::high_resolution_clock::now();
+    qt.optimize();
+    const auto end = std::chrono::high_resolution_clock::now();
+    const std::chrono::duration<double> optimize_time = end - start;
+    std::cout << "Optimize time: " << optimize_time.count() << " seconds\n";
+
+    runQueries("van Emde Boas order", 0);
+    runQueries("van Emde Boas order", prefetchDistance);
 
-    std::cout << "Total nearest neighbor search time: " << nn_search_time.count() << " seconds\n";
-    std::cout << "Average time per search: " << (nn_search_time.count() / NUM_QUERIES) << " seconds\n";
+    // Move the arena onto 2MB pages; the dTLB misses against the run above show what huge pages save
+    qt.setMemoryPolicy(MemoryPolicy{MemoryPolicy::Pages::Transparent, false});
+    runQueries("van Emde Boas order, huge pages", prefetchDistance);
 
     return 0;
 }